@@ -1,9 +1,11 @@
 #include "audio.h"
+#include "audio_presets.h"
 
 #define DR_WAV_IMPLEMENTATION
 #include "dr_wav.h"
 
-#include <FAudioFX.h>
+#include <math.h>
+#include <thread>
 
 const char *audio_sample_filenames[] =
 {
@@ -53,7 +55,7 @@ const char *audio_reverb_preset_names[] =
 };
 
 // see xaudio2fx.h
-const ReverbI3DL2Parameters audio_reverb_presets_i3dl2[] = 
+constexpr ReverbI3DL2Parameters audio_reverb_presets_i3dl2[] = 
 {
 	{100, -1000, -100,0.0f, 1.49f,0.83f, -2602,0.007f,   200,0.011f,100.0f,100.0f,5000.0f},
 	{100, -1000,-6000,0.0f, 0.17f,0.10f, -1204,0.001f,   207,0.002f,100.0f,100.0f,5000.0f},
@@ -85,47 +87,150 @@ const ReverbI3DL2Parameters audio_reverb_presets_i3dl2[] =
 	{100, -1000, -600,0.0f, 1.80f,0.70f, -2000,0.030f, -1400,0.060f,100.0f,100.0f,5000.0f},
 	{100, -1000, -200,0.0f, 1.30f,0.90f,     0,0.002f,     0,0.010f,100.0f, 75.0f,5000.0f}
 };
-const ReverbParameters *audio_reverb_presets = NULL;
+
+// converted to native parameters at compile time
+static constexpr AudioReverbPresetTable<sizeof(audio_reverb_presets_i3dl2) / sizeof(audio_reverb_presets_i3dl2[0])> audio_reverb_presets_native =
+	audio_reverb_convert_table(audio_reverb_presets_i3dl2);
+
+const ReverbParameters *const audio_reverb_presets = audio_reverb_presets_native.presets;
 
 const size_t audio_reverb_preset_count = sizeof(audio_reverb_preset_names) / sizeof(audio_reverb_preset_names[0]);
 
+static_assert(sizeof(audio_reverb_preset_names) / sizeof(audio_reverb_preset_names[0]) == sizeof(audio_reverb_presets_i3dl2) / sizeof(audio_reverb_presets_i3dl2[0]),
+			  "every reverb preset needs a name");
+
+uint32_t audio_reverb_changed_fields(const ReverbParameters *p_old, const ReverbParameters *p_new)
+{
+	uint32_t result = 0;
+
+	result |= (p_old->WetDryMix != p_new->WetDryMix) ? AudioReverbField_WetDryMix : 0;
+	result |= (p_old->ReflectionsDelay != p_new->ReflectionsDelay) ? AudioReverbField_ReflectionsDelay : 0;
+	result |= (p_old->ReverbDelay != p_new->ReverbDelay) ? AudioReverbField_ReverbDelay : 0;
+	result |= (p_old->RearDelay != p_new->RearDelay) ? AudioReverbField_RearDelay : 0;
+	result |= (p_old->PositionLeft != p_new->PositionLeft) ? AudioReverbField_PositionLeft : 0;
+	result |= (p_old->PositionRight != p_new->PositionRight) ? AudioReverbField_PositionRight : 0;
+	result |= (p_old->PositionMatrixLeft != p_new->PositionMatrixLeft) ? AudioReverbField_PositionMatrixLeft : 0;
+	result |= (p_old->PositionMatrixRight != p_new->PositionMatrixRight) ? AudioReverbField_PositionMatrixRight : 0;
+	result |= (p_old->EarlyDiffusion != p_new->EarlyDiffusion) ? AudioReverbField_EarlyDiffusion : 0;
+	result |= (p_old->LateDiffusion != p_new->LateDiffusion) ? AudioReverbField_LateDiffusion : 0;
+	result |= (p_old->LowEQGain != p_new->LowEQGain) ? AudioReverbField_LowEQGain : 0;
+	result |= (p_old->LowEQCutoff != p_new->LowEQCutoff) ? AudioReverbField_LowEQCutoff : 0;
+	result |= (p_old->HighEQGain != p_new->HighEQGain) ? AudioReverbField_HighEQGain : 0;
+	result |= (p_old->HighEQCutoff != p_new->HighEQCutoff) ? AudioReverbField_HighEQCutoff : 0;
+	result |= (p_old->RoomFilterFreq != p_new->RoomFilterFreq) ? AudioReverbField_RoomFilterFreq : 0;
+	result |= (p_old->RoomFilterMain != p_new->RoomFilterMain) ? AudioReverbField_RoomFilterMain : 0;
+	result |= (p_old->RoomFilterHF != p_new->RoomFilterHF) ? AudioReverbField_RoomFilterHF : 0;
+	result |= (p_old->ReflectionsGain != p_new->ReflectionsGain) ? AudioReverbField_ReflectionsGain : 0;
+	result |= (p_old->ReverbGain != p_new->ReverbGain) ? AudioReverbField_ReverbGain : 0;
+	result |= (p_old->DecayTime != p_new->DecayTime) ? AudioReverbField_DecayTime : 0;
+	result |= (p_old->Density != p_new->Density) ? AudioReverbField_Density : 0;
+	result |= (p_old->RoomSize != p_new->RoomSize) ? AudioReverbField_RoomSize : 0;
+
+	return result;
+}
+
+static float audio_lerp(float p_from, float p_to, float p_amount)
+{
+	return p_from + (p_to - p_from) * p_amount;
+}
+
+template <typename T>
+static T audio_lerp_rounded(T p_from, T p_to, float p_amount)
+{
+	return (T) lrintf(audio_lerp((float) p_from, (float) p_to, p_amount));
+}
+
+void audio_reverb_interpolate(const ReverbParameters *p_from, const ReverbParameters *p_to, float p_amount, ReverbParameters *p_result)
+{
+	if (p_amount >= 1.0f)
+	{
+		*p_result = *p_to;
+		return;
+	}
+
+	p_result->WetDryMix = audio_lerp(p_from->WetDryMix, p_to->WetDryMix, p_amount);
+	p_result->ReflectionsDelay = audio_lerp_rounded(p_from->ReflectionsDelay, p_to->ReflectionsDelay, p_amount);
+	p_result->ReverbDelay = audio_lerp_rounded(p_from->ReverbDelay, p_to->ReverbDelay, p_amount);
+	p_result->RearDelay = audio_lerp_rounded(p_from->RearDelay, p_to->RearDelay, p_amount);
+	p_result->PositionLeft = audio_lerp_rounded(p_from->PositionLeft, p_to->PositionLeft, p_amount);
+	p_result->PositionRight = audio_lerp_rounded(p_from->PositionRight, p_to->PositionRight, p_amount);
+	p_result->PositionMatrixLeft = audio_lerp_rounded(p_from->PositionMatrixLeft, p_to->PositionMatrixLeft, p_amount);
+	p_result->PositionMatrixRight = audio_lerp_rounded(p_from->PositionMatrixRight, p_to->PositionMatrixRight, p_amount);
+	p_result->EarlyDiffusion = audio_lerp_rounded(p_from->EarlyDiffusion, p_to->EarlyDiffusion, p_amount);
+	p_result->LateDiffusion = audio_lerp_rounded(p_from->LateDiffusion, p_to->LateDiffusion, p_amount);
+	p_result->LowEQGain = audio_lerp_rounded(p_from->LowEQGain, p_to->LowEQGain, p_amount);
+	p_result->LowEQCutoff = audio_lerp_rounded(p_from->LowEQCutoff, p_to->LowEQCutoff, p_amount);
+	p_result->HighEQGain = audio_lerp_rounded(p_from->HighEQGain, p_to->HighEQGain, p_amount);
+	p_result->HighEQCutoff = audio_lerp_rounded(p_from->HighEQCutoff, p_to->HighEQCutoff, p_amount);
+	p_result->RoomFilterFreq = audio_lerp(p_from->RoomFilterFreq, p_to->RoomFilterFreq, p_amount);
+	p_result->RoomFilterMain = audio_lerp(p_from->RoomFilterMain, p_to->RoomFilterMain, p_amount);
+	p_result->RoomFilterHF = audio_lerp(p_from->RoomFilterHF, p_to->RoomFilterHF, p_amount);
+	p_result->ReflectionsGain = audio_lerp(p_from->ReflectionsGain, p_to->ReflectionsGain, p_amount);
+	p_result->ReverbGain = audio_lerp(p_from->ReverbGain, p_to->ReverbGain, p_amount);
+	p_result->DecayTime = audio_lerp(p_from->DecayTime, p_to->DecayTime, p_amount);
+	p_result->Density = audio_lerp(p_from->Density, p_to->Density, p_amount);
+	p_result->RoomSize = audio_lerp(p_from->RoomSize, p_to->RoomSize, p_amount);
+}
+
 PFN_AUDIO_DESTROY_CONTEXT audio_destroy_context = nullptr;
 PFN_AUDIO_CREATE_VOICE audio_create_voice = nullptr;
 PFN_AUDIO_VOICE_DESTROY audio_voice_destroy = nullptr;
 PFN_AUDIO_VOICE_SET_VOLUME audio_voice_set_volume = nullptr;
 PFN_AUDIO_VOICE_SET_FREQUENCY audio_voice_set_frequency = nullptr;
+PFN_AUDIO_VOICE_SET_SEND_LEVEL audio_voice_set_send_level = nullptr;
 
 PFN_AUDIO_WAVE_LOAD audio_wave_load = nullptr;
 PFN_AUDIO_WAVE_PLAY audio_wave_play = nullptr;
+PFN_AUDIO_WAVE_PLAYING audio_wave_playing = nullptr;
+PFN_AUDIO_AUTOMATION_PLAY audio_automation_play = nullptr;
+PFN_AUDIO_SET_TAIL_MODE audio_set_tail_mode = nullptr;
 
 PFN_AUDIO_EFFECT_CHANGE audio_effect_change = nullptr;
-
-extern AudioContext *xaudio_create_context(bool output_5p1);
-extern AudioContext *faudio_create_context(bool output_5p1);
-
-AudioContext *audio_create_context(AudioEngine p_engine, bool output_5p1)
+PFN_AUDIO_EFFECT_MORPH audio_effect_morph = nullptr;
+PFN_AUDIO_EFFECT_SET_MODE audio_effect_set_mode = nullptr;
+PFN_AUDIO_EFFECT_MODE_TIMES audio_effect_mode_times = nullptr;
+PFN_AUDIO_BEGIN_CHANGES audio_begin_changes = nullptr;
+PFN_AUDIO_COMMIT_CHANGES audio_commit_changes = nullptr;
+
+PFN_AUDIO_RENDER audio_render = nullptr;
+PFN_AUDIO_TRIGGER_LATENCY audio_trigger_latency = nullptr;
+PFN_AUDIO_BYTES_IN_USE audio_bytes_in_use = nullptr;
+PFN_AUDIO_QUANTUM_TIMES audio_quantum_times = nullptr;
+PFN_AUDIO_QUANTUM_FRAMES audio_quantum_frames = nullptr;
+
+extern AudioContext *xaudio_create_context(bool output_5p1, uint32_t p_quantum);
+extern AudioContext *faudio_create_context(bool output_5p1, uint32_t p_quantum);
+extern AudioContext *offline_create_context(bool output_5p1, uint32_t p_quantum);
+extern AudioContext *native_create_context(bool output_5p1, uint32_t p_quantum, unsigned int p_workers);
+
+AudioContext *audio_create_context(AudioEngine p_engine, bool output_5p1, uint32_t p_quantum, unsigned int p_workers)
 {
-	if (audio_reverb_presets == NULL)
+	if (p_quantum < AUDIO_MIN_QUANTUM)
+		p_quantum = AUDIO_MIN_QUANTUM;
+	if (p_quantum > AUDIO_MAX_QUANTUM)
+		p_quantum = AUDIO_MAX_QUANTUM;
+
+	if (p_workers == AUDIO_AUTO_WORKERS)
 	{
-		audio_reverb_presets = new ReverbParameters[audio_reverb_preset_count];
-
-		for (size_t idx = 0; idx < audio_reverb_preset_count; ++idx)
-		{
-			ReverbConvertI3DL2ToNative(
-				(const FAudioFXReverbI3DL2Parameters *) &audio_reverb_presets_i3dl2[idx], 
-				(FAudioFXReverbParameters *) &audio_reverb_presets[idx]);
-		}
+		unsigned int cores = std::thread::hardware_concurrency();
+		p_workers = (cores > 1) ? cores - 1 : 0;
 	}
 
 	switch (p_engine)
 	{
 		#ifdef HAVE_XAUDIO2
 		case AudioEngine_XAudio2:
-			return xaudio_create_context(output_5p1);
+			return xaudio_create_context(output_5p1, p_quantum);
 		#endif
 
 		case AudioEngine_FAudio:
-			return faudio_create_context(output_5p1);
+			return faudio_create_context(output_5p1, p_quantum);
+
+		case AudioEngine_Offline:
+			return offline_create_context(output_5p1, p_quantum);
+
+		case AudioEngine_Native:
+			return native_create_context(output_5p1, p_quantum, p_workers);
 		
 		default:
 			return nullptr;
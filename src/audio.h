@@ -5,6 +5,19 @@
 #include <stdint.h>
 
 const float PI = 3.14159265358979323846f;
+const unsigned int AUDIO_MASTER_SAMPLERATE = 44100;
+
+// frames mixed per processing pass. FAudio and XAudio2 mix 10 ms by default and 21.33 ms with their 1024 quantum flag,
+//	the offline and native engines mix any size in between the limits.
+const uint32_t AUDIO_DEFAULT_QUANTUM = AUDIO_MASTER_SAMPLERATE / 100;
+const uint32_t AUDIO_LONG_QUANTUM = AUDIO_MASTER_SAMPLERATE * 64 / 3000;		// 21.33 ms, 1024 frames at 48 kHz
+const uint32_t AUDIO_MIN_QUANTUM = 16;
+const uint32_t AUDIO_MAX_QUANTUM = 16384;
+
+// extra threads the native engine may use to process the reverb of a 5.1 output: the convolution runs its independent
+//	channel groups in parallel within each quantum. AUDIO_AUTO_WORKERS uses one less than the number of cores, 0 keeps
+//	everything on the mixing thread. The other engines, and the native engine for stereo, ignore it.
+const unsigned int AUDIO_AUTO_WORKERS = 0xffffffff;
 
 // types
 struct AudioContext;
@@ -13,7 +26,9 @@ struct AudioFilter;
 
 enum AudioEngine {
 	AudioEngine_XAudio2,
-	AudioEngine_FAudio
+	AudioEngine_FAudio,
+	AudioEngine_Offline,
+	AudioEngine_Native
 };
 
 enum AudioSampleWave {
@@ -22,6 +37,24 @@ enum AudioSampleWave {
 	AudioWave_SnareDrum03,
 };
 
+enum AudioTrigger {
+	AudioTrigger_WavePlay = 0,
+	AudioTrigger_EffectChange,
+	AudioTrigger_Count
+};
+
+enum AudioEffectMode {
+	AudioEffectMode_Algorithmic = 0,	// the reverb runs its filters and delay network on the voice
+	AudioEffectMode_Convolution,		// the impulse response of the reverb parameters is captured once and convolved with the voice
+	AudioEffectMode_Count
+};
+
+enum AudioTailMode {
+	AudioTailMode_Fixed = 0,			// every sample is followed by 2 seconds of silence for the reverb tail
+	AudioTailMode_Decay,				// the tail is sized from DecayTime and the voice stops once its output died out
+	AudioTailMode_Count
+};
+
 #pragma pack(push, 1)
 
 struct ReverbI3DL2Parameters
@@ -69,11 +102,54 @@ struct ReverbParameters
 
 #pragma pack(pop)
 
+// one bit per field of ReverbParameters, audio_effect_change takes the fields that changed since the previous call
+enum AudioReverbField {
+	AudioReverbField_WetDryMix			 = 1u << 0,
+	AudioReverbField_ReflectionsDelay	 = 1u << 1,
+	AudioReverbField_ReverbDelay		 = 1u << 2,
+	AudioReverbField_RearDelay			 = 1u << 3,
+	AudioReverbField_PositionLeft		 = 1u << 4,
+	AudioReverbField_PositionRight		 = 1u << 5,
+	AudioReverbField_PositionMatrixLeft	 = 1u << 6,
+	AudioReverbField_PositionMatrixRight = 1u << 7,
+	AudioReverbField_EarlyDiffusion		 = 1u << 8,
+	AudioReverbField_LateDiffusion		 = 1u << 9,
+	AudioReverbField_LowEQGain			 = 1u << 10,
+	AudioReverbField_LowEQCutoff		 = 1u << 11,
+	AudioReverbField_HighEQGain			 = 1u << 12,
+	AudioReverbField_HighEQCutoff		 = 1u << 13,
+	AudioReverbField_RoomFilterFreq		 = 1u << 14,
+	AudioReverbField_RoomFilterMain		 = 1u << 15,
+	AudioReverbField_RoomFilterHF		 = 1u << 16,
+	AudioReverbField_ReflectionsGain	 = 1u << 17,
+	AudioReverbField_ReverbGain			 = 1u << 18,
+	AudioReverbField_DecayTime			 = 1u << 19,
+	AudioReverbField_Density			 = 1u << 20,
+	AudioReverbField_RoomSize			 = 1u << 21,
+	AudioReverbField_All				 = (1u << 22) - 1
+};
+
+// the AudioReverbField bits of the fields that differ between p_old and p_new
+uint32_t audio_reverb_changed_fields(const ReverbParameters *p_old, const ReverbParameters *p_new);
+
+// p_amount (0 - 1) of the way from p_from to p_to, integer fields are rounded. The gains are in dB, so a linear step is
+//	an even fade to the ear. At 1 the result is exactly p_to.
+void audio_reverb_interpolate(const ReverbParameters *p_from, const ReverbParameters *p_to, float p_amount, ReverbParameters *p_result);
+
+// one state of the effect in a recorded automation, p_frame sample frames (AUDIO_MASTER_SAMPLERATE) after the voice
+//	started
+struct AudioAutomationEvent
+{
+	uint64_t		 frame;
+	bool			 enabled;
+	ReverbParameters params;
+};
+
 extern const char *audio_sample_filenames[];
 extern const char *audio_stereo_filenames[];
 extern const char *audio_reverb_preset_names[];
 extern const ReverbI3DL2Parameters audio_reverb_presets_i3dl2[];
-extern const ReverbParameters	   *audio_reverb_presets;
+extern const ReverbParameters	   *const audio_reverb_presets;
 extern const size_t				   audio_reverb_preset_count;
 
 typedef void(*PFN_AUDIO_DESTROY_CONTEXT)(AudioContext *p_context);
@@ -83,23 +159,108 @@ typedef void (*PFN_AUDIO_VOICE_DESTROY)(AudioVoice *p_voice);
 typedef void (*PFN_AUDIO_VOICE_SET_VOLUME)(AudioVoice *p_voice, float p_volume);
 typedef void (*PFN_AUDIO_VOICE_SET_FREQUENCY)(AudioVoice *p_vioce, float p_frequency);
 
+// every context runs one reverb on a submix bus that all of its voices send to, so the cost of the reverb doesn't grow
+//	with the number of voices. p_level (0 - 1, default 1) is the part of the voice sent to the bus, the rest goes
+//	straight to the master without reverb. The bus mixes dry and wet by WetDryMix itself, at 1 a voice sounds exactly
+//	like it did with the reverb in its own effect chain.
+typedef void (*PFN_AUDIO_VOICE_SET_SEND_LEVEL)(AudioVoice *p_voice, float p_level);
+
 typedef void (*PFN_AUDIO_WAVE_LOAD)(AudioContext *p_context, AudioSampleWave sample, bool stereo);
 typedef void (*PFN_AUDIO_WAVE_PLAY)(AudioContext *p_context);
+typedef bool (*PFN_AUDIO_WAVE_PLAYING)(AudioContext *p_context);
+
+// plays the voice like audio_wave_play and has the mixer apply p_events (sorted by frame) at their frame of the voice, as
+//	if audio_effect_change had been called right there. The native and offline engines split the quantum at the event,
+//	the FAudio engine applies it to the whole pass it falls in. The effect keeps the state of the last event until a
+//	later audio_effect_change, or until the next play goes back to the state posted last; events the voice doesn't live
+//	to are dropped. p_events has to stay valid until then. Returns false, without playing, when the engine has no mixer
+//	callback to apply them in (XAudio2) and in the native convolution mode, which would need the impulse response of
+//	every event. A replay that is still running when the mode switches to convolution only applies the enabled state and
+//	WetDryMix of its events.
+typedef bool (*PFN_AUDIO_AUTOMATION_PLAY)(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count);
+
+// posts a new state of the effect, the mixer applies it before its next quantum. Never waits on the mixer, so it
+//	may be called from one other thread while audio_render runs (XAudio2 applies effect parameters asynchronously itself).
+//	audio_effect_set_mode posts the same way. p_changed (AudioReverbField bits) tells the engine which fields of p_params
+//	differ from the previous call, pass AudioReverbField_All when unknown.
+typedef void(*PFN_AUDIO_EFFECT_CHANGE)(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params, uint32_t p_changed);
+
+// crossfades the parameters of the effect from wherever they are now to p_target over p_seconds, leaving it enabled or
+//	disabled as it is. The mixer interpolates on its own thread, the caller posts once instead of every step: per 64
+//	frames in the native engine, per quantum in the offline and FAudio engines. A later audio_effect_change or morph
+//	takes over from the current step. In the native convolution mode the response of the target is used right away, only
+//	the algorithmic reverb morphs. XAudio2 has no callback on its mixing thread and changes to p_target at once.
+typedef void (*PFN_AUDIO_EFFECT_MORPH)(AudioContext *p_context, const ReverbParameters *p_target, float p_seconds);
+
+// selects how the reverb is computed. Returns false, and keeps the current mode, when the engine doesn't support p_mode.
+//	Only the native engine has a convolution mode.
+typedef bool (*PFN_AUDIO_EFFECT_SET_MODE)(AudioContext *p_context, AudioEffectMode p_mode);
+
+// groups the following voice and effect calls until audio_commit_changes, the mixer applies all of them in the same
+//	quantum instead of one by one. The GUI wraps every frame in a batch. FAudio and XAudio2 queue the voice calls in an
+//	operation set, the native and offline engines post the effect once at the commit (their voice setters are plain
+//	stores the caller already keeps away from the mixer). Batches don't nest, audio_wave_load / audio_wave_play act
+//	immediately.
+typedef void (*PFN_AUDIO_BEGIN_CHANGES)(AudioContext *p_context);
+typedef void (*PFN_AUDIO_COMMIT_CHANGES)(AudioContext *p_context);
 
-typedef void(*PFN_AUDIO_EFFECT_CHANGE)(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params);
+// like audio_quantum_times, but only the time spent in the reverb of the voice, kept separately for every mode
+typedef size_t (*PFN_AUDIO_EFFECT_MODE_TIMES)(AudioContext *p_context, AudioEffectMode p_mode, float *p_times, size_t p_max);
+
+// selects how long the voice keeps running after its sample, from the next audio_wave_play on. Returns false, and keeps
+//	the current mode, when the engine doesn't support p_mode. XAudio2 runs the effect of a voice without queued buffers,
+//	so it has no silence to size and only supports AudioTailMode_Fixed.
+typedef bool (*PFN_AUDIO_SET_TAIL_MODE)(AudioContext *p_context, AudioTailMode p_mode);
+
+// writes the next p_frames frames of interleaved float output (2 or 6 channels at AUDIO_MASTER_SAMPLERATE) to p_output.
+//	The offline and native engines render on the caller's thread, the native one from the audio device callback of the
+//	application as well. FAudio and XAudio2 mix on their own thread and return 0.
+typedef size_t (*PFN_AUDIO_RENDER)(AudioContext *p_context, float *p_output, size_t p_frames);
+
+// latency in microseconds from the last call of audio_wave_play / audio_effect_change until the first quantum with audible
+//	output / the new parameters was mixed into the mastering voice. Negative while the measurement is still pending.
+typedef double (*PFN_AUDIO_TRIGGER_LATENCY)(AudioContext *p_context, AudioTrigger p_trigger);
+
+// bytes currently allocated by the context itself: the context and voice structures, the loaded wave and the buffers
+//	the context submits or mixes into. Memory held inside the engine library is not included.
+typedef size_t (*PFN_AUDIO_BYTES_IN_USE)(AudioContext *p_context);
+
+// copies the processing time in microseconds of the most recent mixing passes (at most p_max), oldest first. Returns the
+//	number of values copied, 0 when the engine is not instrumented.
+typedef size_t (*PFN_AUDIO_QUANTUM_TIMES)(AudioContext *p_context, float *p_times, size_t p_max);
+
+// frames per processing pass the context actually mixes, at AUDIO_MASTER_SAMPLERATE. This is the requested quantum
+//	clamped to the limits, or for FAudio and XAudio2 the closest of the two sizes they support.
+typedef uint32_t (*PFN_AUDIO_QUANTUM_FRAMES)(AudioContext *p_context);
 
 // API
-AudioContext *audio_create_context(AudioEngine p_engine, bool output_5p1);
+AudioContext *audio_create_context(AudioEngine p_engine, bool output_5p1, uint32_t p_quantum = AUDIO_DEFAULT_QUANTUM,
+									unsigned int p_workers = AUDIO_AUTO_WORKERS);
 
 extern PFN_AUDIO_DESTROY_CONTEXT audio_destroy_context;
 extern PFN_AUDIO_CREATE_VOICE audio_create_voice;
 extern PFN_AUDIO_VOICE_DESTROY audio_voice_destroy;
 extern PFN_AUDIO_VOICE_SET_VOLUME audio_voice_set_volume;
 extern PFN_AUDIO_VOICE_SET_FREQUENCY audio_voice_set_frequency;
+extern PFN_AUDIO_VOICE_SET_SEND_LEVEL audio_voice_set_send_level;
 
 extern PFN_AUDIO_WAVE_LOAD audio_wave_load;
 extern PFN_AUDIO_WAVE_PLAY audio_wave_play;
+extern PFN_AUDIO_WAVE_PLAYING audio_wave_playing;
+extern PFN_AUDIO_AUTOMATION_PLAY audio_automation_play;
+extern PFN_AUDIO_SET_TAIL_MODE audio_set_tail_mode;
 
 extern PFN_AUDIO_EFFECT_CHANGE audio_effect_change;
+extern PFN_AUDIO_EFFECT_MORPH audio_effect_morph;
+extern PFN_AUDIO_EFFECT_SET_MODE audio_effect_set_mode;
+extern PFN_AUDIO_EFFECT_MODE_TIMES audio_effect_mode_times;
+extern PFN_AUDIO_BEGIN_CHANGES audio_begin_changes;
+extern PFN_AUDIO_COMMIT_CHANGES audio_commit_changes;
+
+extern PFN_AUDIO_RENDER audio_render;
+extern PFN_AUDIO_TRIGGER_LATENCY audio_trigger_latency;
+extern PFN_AUDIO_BYTES_IN_USE audio_bytes_in_use;
+extern PFN_AUDIO_QUANTUM_TIMES audio_quantum_times;
+extern PFN_AUDIO_QUANTUM_FRAMES audio_quantum_frames;
 
 #endif // FAUDIOFILTERDEMO_AUDIO_H
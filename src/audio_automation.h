@@ -0,0 +1,238 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_AUTOMATION_H
+#define FAUDIOFILTERDEMO_AUDIO_AUTOMATION_H
+
+#include "audio.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// parameter automation: AudioAutomation records the states of the effect with the sample frame they were set at, counted
+//	from the start of the voice, audio_automation_play replays them against the voice. The mixer walks the events with
+//	an AudioAutomationCursor. Recordings are saved as text, one event per line: the frame, 0 / 1 for enabled and the
+//	fields of ReverbParameters in declaration order, so the same run can be replayed by the GUI and rendered offline.
+
+const char *const AUDIO_AUTOMATION_HEADER = "faudio-automation 1";
+
+class AudioAutomation
+{
+	public :
+		AudioAutomation() : m_recording(false)
+		{
+		}
+
+		// drops the events recorded so far and starts counting frames from now, the voice should start right along
+		void start(bool p_enabled, const ReverbParameters &p_params)
+		{
+			m_events.clear();
+			m_start = std::chrono::steady_clock::now();
+			m_recording = true;
+			record(p_enabled, p_params);
+		}
+
+		void stop()
+		{
+			m_recording = false;
+		}
+
+		bool recording() const
+		{
+			return m_recording;
+		}
+
+		// appends the state set now, a state set in the same frame as the previous one replaces it
+		void record(bool p_enabled, const ReverbParameters &p_params)
+		{
+			if (!m_recording)
+				return;
+
+			std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+			uint64_t micros = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+			AudioAutomationEvent event;
+			event.frame = micros * AUDIO_MASTER_SAMPLERATE / 1000000;
+			event.enabled = p_enabled;
+			event.params = p_params;
+
+			if (!m_events.empty() && m_events.back().frame >= event.frame)
+			{
+				event.frame = m_events.back().frame;
+				m_events.pop_back();
+			}
+
+			m_events.push_back(event);
+		}
+
+		const AudioAutomationEvent *events() const
+		{
+			return m_events.data();
+		}
+
+		size_t count() const
+		{
+			return m_events.size();
+		}
+
+		// frame of the last event
+		uint64_t length() const
+		{
+			return m_events.empty() ? 0 : m_events.back().frame;
+		}
+
+		bool save(const char *p_filename) const
+		{
+			FILE *file = fopen(p_filename, "w");
+
+			if (file == NULL)
+				return false;
+
+			fprintf(file, "%s\n", AUDIO_AUTOMATION_HEADER);
+
+			for (const AudioAutomationEvent &event : m_events)
+			{
+				const ReverbParameters &p = event.params;
+
+				// 9 digits bring every float back bit-exact
+				fprintf(file, "%llu %d %.9g %u %u %u %u %u %u %u %u %u %u %u %u %u %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+						(unsigned long long) event.frame, event.enabled ? 1 : 0,
+						p.WetDryMix, p.ReflectionsDelay, p.ReverbDelay, p.RearDelay, p.PositionLeft, p.PositionRight,
+						p.PositionMatrixLeft, p.PositionMatrixRight, p.EarlyDiffusion, p.LateDiffusion, p.LowEQGain,
+						p.LowEQCutoff, p.HighEQGain, p.HighEQCutoff, p.RoomFilterFreq, p.RoomFilterMain, p.RoomFilterHF,
+						p.ReflectionsGain, p.ReverbGain, p.DecayTime, p.Density, p.RoomSize);
+			}
+
+			bool ok = ferror(file) == 0;
+			fclose(file);
+			return ok;
+		}
+
+		// replaces the events with the ones of the file, false (and nothing loaded) when it isn't a valid recording
+		bool load(const char *p_filename)
+		{
+			FILE *file = fopen(p_filename, "r");
+
+			if (file == NULL)
+				return false;
+
+			char header[64];
+			bool ok = fgets(header, sizeof(header), file) != NULL && strncmp(header, AUDIO_AUTOMATION_HEADER, strlen(AUDIO_AUTOMATION_HEADER)) == 0;
+
+			std::vector<AudioAutomationEvent> events;
+
+			while (ok)
+			{
+				unsigned long long frame;
+				int enabled;
+				unsigned int u[13];
+				ReverbParameters p;
+
+				int fields = fscanf(file, "%llu %d %f %u %u %u %u %u %u %u %u %u %u %u %u %u %f %f %f %f %f %f %f %f",
+									&frame, &enabled, &p.WetDryMix, &u[0], &u[1], &u[2], &u[3], &u[4], &u[5], &u[6], &u[7],
+									&u[8], &u[9], &u[10], &u[11], &u[12], &p.RoomFilterFreq, &p.RoomFilterMain,
+									&p.RoomFilterHF, &p.ReflectionsGain, &p.ReverbGain, &p.DecayTime, &p.Density, &p.RoomSize);
+
+				if (fields == EOF)
+					break;
+
+				// events have to come in order, the mixer only ever walks forward
+				ok = fields == 24 && (events.empty() || frame >= events.back().frame);
+
+				p.ReflectionsDelay = u[0];
+				p.ReverbDelay = (uint8_t) u[1];
+				p.RearDelay = (uint8_t) u[2];
+				p.PositionLeft = (uint8_t) u[3];
+				p.PositionRight = (uint8_t) u[4];
+				p.PositionMatrixLeft = (uint8_t) u[5];
+				p.PositionMatrixRight = (uint8_t) u[6];
+				p.EarlyDiffusion = (uint8_t) u[7];
+				p.LateDiffusion = (uint8_t) u[8];
+				p.LowEQGain = (uint8_t) u[9];
+				p.LowEQCutoff = (uint8_t) u[10];
+				p.HighEQGain = (uint8_t) u[11];
+				p.HighEQCutoff = (uint8_t) u[12];
+
+				AudioAutomationEvent event;
+				event.frame = frame;
+				event.enabled = enabled != 0;
+				event.params = p;
+				events.push_back(event);
+			}
+
+			fclose(file);
+
+			if (!ok || events.empty())
+				return false;
+
+			m_events.swap(events);
+			m_recording = false;
+			return true;
+		}
+
+	private :
+		std::vector<AudioAutomationEvent>		m_events;
+		std::chrono::steady_clock::time_point	m_start;
+		bool									m_recording;
+};
+
+// mixer side: walks the events of an automation along the frames of the voice. Per quantum the mixer takes the events
+//	due, renders up to the next one and advances by what it rendered.
+class AudioAutomationCursor
+{
+	public :
+		AudioAutomationCursor() : m_events(nullptr), m_count(0), m_next(0), m_frame(0)
+		{
+		}
+
+		void start(const AudioAutomationEvent *p_events, size_t p_count)
+		{
+			m_events = p_events;
+			m_count = p_count;
+			m_next = 0;
+			m_frame = 0;
+		}
+
+		void stop()
+		{
+			m_count = 0;
+			m_next = 0;
+		}
+
+		bool active() const
+		{
+			return m_next < m_count;
+		}
+
+		// the next event before the frame p_frames from now, or null once there is none. Late events come right away.
+		const AudioAutomationEvent *take(uint32_t p_frames)
+		{
+			if (m_next >= m_count || m_events[m_next].frame >= m_frame + p_frames)
+				return nullptr;
+
+			return &m_events[m_next++];
+		}
+
+		// frames until the next event, at most p_max
+		uint32_t frames_to_next(uint32_t p_max) const
+		{
+			if (m_next >= m_count || m_events[m_next].frame >= m_frame + p_max)
+				return p_max;
+
+			return (uint32_t) (m_events[m_next].frame - m_frame);
+		}
+
+		void advance(uint32_t p_frames)
+		{
+			m_frame += p_frames;
+		}
+
+	private :
+		const AudioAutomationEvent *m_events;
+		size_t						m_count;
+		size_t						m_next;
+		uint64_t					m_frame;		// frames of the voice so far
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_AUTOMATION_H
@@ -4,6 +4,32 @@
 #include <FAudioFX.h>
 
 #include "dr_wav.h"
+#include "audio_automation.h"
+#include "audio_mailbox.h"
+#include "audio_probe.h"
+#include "audio_tail.h"
+#include "audio_timing.h"
+
+#include <mutex>
+
+const size_t FAUDIO_FIXED_SILENCE_FRAMES = 2 * 48000;
+
+struct FAudioContextCallback
+{
+	FAudioEngineCallback callback;
+	struct AudioContext *context;
+};
+
+// state of the effect as the API last set it, posted to the mixer thread through a mailbox
+struct FAudioEffectMessage
+{
+	uint64_t		 serial;			// counts the posts
+	bool			 enabled;
+	ReverbParameters params;
+	uint64_t		 params_serial;		// counts the changes of params, a repost with the same one leaves a morph running
+	uint32_t		 morph_frames;		// 0 to set params at once
+	uint32_t		 commit_through;	// last operation set of a batch, the mixer commits every set up to it
+};
 
 struct AudioContext 
 {
@@ -11,6 +37,13 @@ struct AudioContext
 	bool output_5p1;
 	FAudioMasteringVoice *mastering_voice;
 
+	float					  meter_peaks[6];
+	float					  meter_rms[6];
+	FAudioContextCallback	  engine_callback;
+	AudioTriggerProbe		  probe;
+	AudioTimingHistory		  quantum_times;
+	uint32_t				  quantum_frames;
+
 	unsigned int wav_channels;
 	unsigned int wav_samplerate;
 	drwav_uint64 wav_sample_count;
@@ -19,17 +52,68 @@ struct AudioContext
 	struct AudioVoice *voice;
 	FAudioBuffer      buffer;
 	FAudioBuffer	  silence;
-
+	float *			  silence_samples;		// owned, reallocated when the channel count changes or it has to grow
+	unsigned int	  silence_channels;
+	size_t			  silence_frames;		// allocated, the buffer plays PlayLength of them
+	float			  frequency;
+
+	AudioTailMode	  tail_mode;
+	AudioTailDetector tail;
+	uint32_t		  tail_hold_frames;
+	std::mutex		  tail_lock;			// held while the API thread changes the voice or the bus, the mixer only try_locks it
+
+	// the reverb runs on a submix voice every source voice sends to, its cost doesn't depend on the number of voices
+	FAudioSubmixVoice *	   reverb_bus;
+	unsigned int		   bus_channels;
 	FAudioEffectDescriptor reverb_effect;
 	FAudioEffectChain	   effect_chain;
-	ReverbParameters	   reverb_params;
+	ReverbParameters	   reverb_params;		// API side, the latest state posted to the mailbox
 	bool				   reverb_enabled;
+	uint64_t			   params_serial;
+	uint32_t			   morph_frames;
+	uint64_t			   effect_serial;		// API side, serial of the latest post
+	bool				   effect_changed;		// API side, the effect changed since its last post, which arms the probe
+
+	// audio_effect_change doesn't call into FAudio, which would take the engine locks on the API thread. It posts the
+	//	new state and the mixer thread applies it to the bus at the end of the current pass.
+	AudioMailbox<FAudioEffectMessage> effect_mailbox;
+	bool				   bus_effect_enabled;	// mixer side, what the bus currently runs with
+	ReverbParameters	   bus_effect_params;
+	uint64_t			   bus_params_serial;
+	bool				   bus_posted_enabled;	// mixer side, the state last taken from the mailbox
+	ReverbParameters	   bus_posted_params;
+
+	// audio_effect_morph, run by the mixer: bus_effect_params steps from morph_from to morph_to once per pass
+	ReverbParameters	   morph_from;
+	ReverbParameters	   morph_to;
+	uint32_t			   bus_morph_frames;	// 0 while no morph runs
+	uint32_t			   bus_morph_position;
+
+	// audio_automation_play: events of the playing voice, started under tail_lock. The mixer applies the last event
+	//	due in a pass to the whole pass, a pass it can't take the lock in moves the events one pass later. The bus keeps
+	//	the state of the last event until the next play, which goes back to the posted state first.
+	AudioAutomationCursor  automation;
+	bool				   bus_automated;		// mixer side, an event changed the effect since the last posted state
+	bool				   bus_restore;			// set under tail_lock by a play
+
+	// between audio_begin_changes and audio_commit_changes the voice calls are queued in an operation set, the effect
+	//	is only posted at the commit. The mixer applies the effect and commits the set together, a pass never mixes
+	//	half of a batch.
+	uint32_t			   operation_set;		// API side, the open batch or FAUDIO_COMMIT_NOW
+	uint32_t			   operation_last;		// API side, the set of the most recent batch
+	bool				   operation_changed;	// API side, the open batch has anything to commit
+	uint32_t			   operation_committed;	// mixer side
 };
 
 struct AudioVoice
 {
 	AudioContext *context;
 	FAudioSourceVoice *voice;
+
+	unsigned int channels;
+	float		 send_level;
+	float		 bus_matrix[2 * 2];			// default output matrices of the two sends, scaled by the send level
+	float		 master_matrix[2 * 6];
 };
 
 struct AudioFilter
@@ -38,32 +122,334 @@ struct AudioFilter
 	FAudioFilterParameters params;
 };
 
+// tail-aware playback: once only the silence after the sample is left, stops the voice as soon as the output died out.
+//	A stopped voice isn't mixed until the next audio_wave_play, only the reverb bus keeps running.
+static void faudio_tail_update(AudioContext *p_context, float p_peak)
+{
+	// never wait on the mixer thread, the next pass checks again
+	std::unique_lock<std::mutex> lock(p_context->tail_lock, std::try_to_lock);
+
+	if (!lock.owns_lock() || p_context->tail_mode != AudioTailMode_Decay || p_context->voice == NULL)
+		return;
+
+	FAudioVoiceState state;
+	FAudioSourceVoice_GetState(p_context->voice->voice, &state, FAUDIO_VOICE_NOSAMPLESPLAYED);
+
+	if (state.BuffersQueued == 0 || state.pCurrentBufferContext != &p_context->silence)
+		return;
+
+	if (p_context->tail.decayed(p_peak, p_context->quantum_frames, p_context->tail_hold_frames))
+	{
+		FAudioSourceVoice_Stop(p_context->voice->voice, 0, FAUDIO_COMMIT_NOW);
+		FAudioSourceVoice_FlushSourceBuffers(p_context->voice->voice);
+	}
+}
+
+// makes the silence buffer submitted after the sample p_frames long, the allocation only grows. The voice must not be
+//	playing the silence while it's reallocated.
+static void faudio_silence_resize(AudioContext *p_context, unsigned int p_channels, size_t p_frames)
+{
+	if (p_context->silence_samples == NULL || p_context->silence_channels != p_channels || p_context->silence_frames < p_frames)
+	{
+		delete[] p_context->silence_samples;
+		p_context->silence_samples = new float[p_frames * p_channels]();
+		p_context->silence_channels = p_channels;
+		p_context->silence_frames = p_frames;
+	}
+
+	p_context->silence = { 0 };
+	p_context->silence.AudioBytes = 4 * p_frames * p_channels;
+	p_context->silence.pAudioData = (uint8_t *)p_context->silence_samples;
+	p_context->silence.Flags = FAUDIO_END_OF_STREAM;
+	p_context->silence.PlayBegin = 0;
+	p_context->silence.PlayLength = p_frames;
+	p_context->silence.LoopBegin = 0;
+	p_context->silence.LoopLength = 0;
+	p_context->silence.LoopCount = 0;
+	p_context->silence.pContext = &p_context->silence;
+}
+
+// operation sets are numbered from 1 on, FAUDIO_COMMIT_NOW (0) is never used for a batch
+static uint32_t faudio_operation_set_next(uint32_t p_set)
+{
+	return (p_set == UINT32_MAX) ? 1 : p_set + 1;
+}
+
+// mixer side: switches the effect of the bus on or off
+static void faudio_bus_enable(AudioContext *p_context, bool p_enabled)
+{
+	if (p_context->bus_effect_enabled && !p_enabled)
+		FAudioVoice_DisableEffect(p_context->reverb_bus, 0, FAUDIO_COMMIT_NOW);
+	else if (!p_context->bus_effect_enabled && p_enabled)
+		FAudioVoice_EnableEffect(p_context->reverb_bus, 0, FAUDIO_COMMIT_NOW);
+
+	p_context->bus_effect_enabled = p_enabled;
+}
+
+// mixer side: sets the effect of the bus to a state at once, a running morph ends
+static void faudio_bus_apply(AudioContext *p_context, bool p_enabled, const ReverbParameters *p_params)
+{
+	faudio_bus_enable(p_context, p_enabled);
+	p_context->bus_morph_frames = 0;
+
+	if (audio_reverb_changed_fields(&p_context->bus_effect_params, p_params) != 0)
+	{
+		p_context->bus_effect_params = *p_params;
+		FAudioVoice_SetEffectParameters(p_context->reverb_bus, 0, p_params, sizeof(ReverbParameters), FAUDIO_COMMIT_NOW);
+	}
+}
+
+// mixer side: applies the latest posted state of the effect and commits the operation sets of the batches posted with
+//	it. FAudio runs committed sets right after the pass end callbacks, so both take effect with the next pass. While the
+//	API thread recreates the bus the state stays in the mailbox for the next pass.
+static void faudio_effect_receive(AudioContext *p_context)
+{
+	std::unique_lock<std::mutex> lock(p_context->tail_lock, std::try_to_lock);
+
+	if (!lock.owns_lock() || p_context->reverb_bus == NULL)
+		return;
+
+	const FAudioEffectMessage *message = p_context->effect_mailbox.fetch();
+
+	if (message != NULL)
+	{
+		faudio_bus_enable(p_context, message->enabled);
+		p_context->bus_posted_enabled = message->enabled;
+		p_context->bus_posted_params = message->params;
+
+		if (message->params_serial != p_context->bus_params_serial)
+		{
+			p_context->bus_params_serial = message->params_serial;
+			p_context->bus_morph_frames = message->morph_frames;
+
+			if (message->morph_frames > 0)
+			{
+				// from the step the bus is at, a morph replaces the one still running
+				p_context->morph_from = p_context->bus_effect_params;
+				p_context->morph_to = message->params;
+				p_context->bus_morph_position = 0;
+			}
+			else if (audio_reverb_changed_fields(&p_context->bus_effect_params, &message->params) != 0)
+			{
+				// new parameters make the reverb recompute its state, toggling the effect doesn't
+				p_context->bus_effect_params = message->params;
+				FAudioVoice_SetEffectParameters(p_context->reverb_bus, 0, &message->params, sizeof(message->params), FAUDIO_COMMIT_NOW);
+			}
+		}
+
+		// a message replaced before the mixer got to it leaves the sets of its batch behind, they are committed in order
+		while (p_context->operation_committed != message->commit_through)
+		{
+			p_context->operation_committed = faudio_operation_set_next(p_context->operation_committed);
+			FAudio_CommitOperationSet(p_context->faudio, p_context->operation_committed);
+		}
+
+		// the pass that just ended was mixed with the previous state, only the next one reflects this post
+		p_context->probe.applied(message->serial);
+	}
+
+	// a play starts from the posted state again, not from where the events of the previous one left the bus
+	if (p_context->bus_restore)
+	{
+		if (p_context->bus_automated)
+			faudio_bus_apply(p_context, p_context->bus_posted_enabled, &p_context->bus_posted_params);
+
+		p_context->bus_restore = false;
+		p_context->bus_automated = false;
+	}
+
+	// the events of the automation that fall into the next pass, only the last one is heard
+	if (p_context->automation.active())
+	{
+		const AudioAutomationEvent *event = NULL;
+
+		while (const AudioAutomationEvent *due = p_context->automation.take(p_context->quantum_frames))
+			event = due;
+
+		if (event != NULL)
+		{
+			faudio_bus_apply(p_context, event->enabled, &event->params);
+			p_context->bus_automated = true;
+		}
+
+		p_context->automation.advance(p_context->quantum_frames);
+	}
+
+	// a running morph takes one step per pass, the next pass mixes with the parameters at its end
+	if (p_context->bus_morph_frames > 0)
+	{
+		p_context->bus_morph_position += p_context->quantum_frames;
+
+		if (p_context->bus_morph_position >= p_context->bus_morph_frames)
+		{
+			p_context->bus_effect_params = p_context->morph_to;
+			p_context->bus_morph_frames = 0;
+		}
+		else
+		{
+			float amount = (float) p_context->bus_morph_position / (float) p_context->bus_morph_frames;
+			audio_reverb_interpolate(&p_context->morph_from, &p_context->morph_to, amount, &p_context->bus_effect_params);
+		}
+
+		FAudioVoice_SetEffectParameters(p_context->reverb_bus, 0, &p_context->bus_effect_params, sizeof(ReverbParameters), FAUDIO_COMMIT_NOW);
+	}
+}
+
+void FAUDIOCALL faudio_on_pass_start(FAudioEngineCallback *p_callback)
+{
+	AudioContext *context = ((FAudioContextCallback *) p_callback)->context;
+	context->probe.pass_start();
+	context->quantum_times.start();
+}
+
+void FAUDIOCALL faudio_on_pass_end(FAudioEngineCallback *p_callback)
+{
+	AudioContext *context = ((FAudioContextCallback *) p_callback)->context;
+	context->quantum_times.stop();
+
+	// the volume meter on the mastering voice reports the peak level of the pass that just finished
+	FAudioFXVolumeMeterLevels levels;
+	levels.pPeakLevels = context->meter_peaks;
+	levels.pRMSLevels = context->meter_rms;
+	levels.ChannelCount = context->output_5p1 ? 6 : 2;
+
+	FAudioVoice_GetEffectParameters(context->mastering_voice, 0, &levels, sizeof(levels));
+
+	bool audible = false;
+	for (uint32_t ch = 0; ch < levels.ChannelCount; ++ch)
+	{
+		audible |= levels.pPeakLevels[ch] > 0.0f;
+	}
+
+	context->probe.pass_end(audible);
+
+	float peak = 0.0f;
+	for (uint32_t ch = 0; ch < levels.ChannelCount; ++ch)
+	{
+		peak = fmaxf(peak, levels.pPeakLevels[ch]);
+	}
+
+	faudio_tail_update(context, peak);
+	faudio_effect_receive(context);
+}
+
 void faudio_destroy_context(AudioContext *p_context)
 {
+	// no more passes may look at the voice once it's gone
+	FAudio_UnregisterForCallbacks(p_context->faudio, &p_context->engine_callback.callback);
+
+	if (p_context->voice)
+	{
+		audio_voice_destroy(p_context->voice);
+	}
+
+	if (p_context->reverb_bus)
+	{
+		FAudioVoice_DestroyVoice(p_context->reverb_bus);
+	}
+
 	FAudioVoice_DestroyVoice(p_context->mastering_voice);
-	// FAudioDestroy(p_context->faudio);
+	FAudio_Release(p_context->faudio);
+
+	drwav_free(p_context->wav_samples);
+	delete[] p_context->silence_samples;
 	delete p_context;
 }
 
-AudioVoice *faudio_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels)
+void faudio_reverb_set_params(AudioContext *context)
+{
+	FAudioVoice_SetEffectParameters(context->reverb_bus, 0, &context->reverb_params, sizeof(context->reverb_params), FAUDIO_COMMIT_NOW);
+}
+
+// (re)creates the reverb bus with p_channels in and out, no voice may send to the old bus anymore
+static bool faudio_bus_create(AudioContext *p_context, unsigned int p_channels)
 {
+	if (p_context->reverb_bus)
+	{
+		FAudioVoice_DestroyVoice(p_context->reverb_bus);
+		p_context->reverb_bus = NULL;
+		p_context->bus_channels = 0;
+	}
+
 	// create reverb effect
 	void *xapo = nullptr;
 	uint32_t hr = FAudioCreateReverb(&xapo, 0);
 
 	if (hr != 0)
 	{
-		return nullptr;
+		return false;
 	}
 
 	// create effect chain
 	p_context->reverb_effect.InitialState = p_context->reverb_enabled;
-	p_context->reverb_effect.OutputChannels = p_context->wav_channels;
+	p_context->reverb_effect.OutputChannels = p_channels;
 	p_context->reverb_effect.pEffect = xapo;
 
 	p_context->effect_chain.EffectCount = 1;
 	p_context->effect_chain.pEffectDescriptors = &p_context->reverb_effect;
 
+	// create a submix voice that outputs to the mastering voice
+	FAudioSubmixVoice *bus;
+	hr = FAudio_CreateSubmixVoice(p_context->faudio, &bus, p_channels, AUDIO_MASTER_SAMPLERATE, 0, 0, NULL, &p_context->effect_chain);
+
+	// the voice holds its own reference to the effect
+	((FAPO *) xapo)->Release(xapo);
+
+	if (hr != 0)
+	{
+		return false;
+	}
+
+	p_context->reverb_bus = bus;
+	p_context->bus_channels = p_channels;
+	p_context->bus_effect_enabled = p_context->reverb_enabled;
+	p_context->bus_effect_params = p_context->reverb_params;
+	p_context->bus_posted_enabled = p_context->reverb_enabled;
+	p_context->bus_posted_params = p_context->reverb_params;
+	p_context->bus_automated = false;
+	faudio_reverb_set_params(p_context);
+	return true;
+}
+
+void faudio_voice_set_send_level(AudioVoice *p_voice, float p_level)
+{
+	AudioContext *context = p_voice->context;
+	unsigned int master_channels = context->output_5p1 ? 6 : 2;
+
+	p_voice->send_level = fminf(fmaxf(p_level, 0.0f), 1.0f);
+
+	float bus_matrix[2 * 2];
+	float master_matrix[2 * 6];
+
+	for (unsigned int idx = 0; idx < p_voice->channels * context->bus_channels; ++idx)
+		bus_matrix[idx] = p_voice->bus_matrix[idx] * p_voice->send_level;
+
+	for (unsigned int idx = 0; idx < p_voice->channels * master_channels; ++idx)
+		master_matrix[idx] = p_voice->master_matrix[idx] * (1.0f - p_voice->send_level);
+
+	FAudioVoice_SetOutputMatrix(p_voice->voice, context->reverb_bus, p_voice->channels, context->bus_channels, bus_matrix, context->operation_set);
+	FAudioVoice_SetOutputMatrix(p_voice->voice, context->mastering_voice, p_voice->channels, master_channels, master_matrix, context->operation_set);
+	context->operation_changed = true;
+}
+
+AudioVoice *faudio_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels)
+{
+	if (p_context->reverb_bus == NULL)
+	{
+		return nullptr;
+	}
+
+	// send to the reverb bus and straight to the mastering voice, the send level splits the voice between the two
+	FAudioSendDescriptor sends[2];
+	sends[0].Flags = 0;
+	sends[0].pOutputVoice = p_context->reverb_bus;
+	sends[1].Flags = 0;
+	sends[1].pOutputVoice = p_context->mastering_voice;
+
+	FAudioVoiceSends send_list;
+	send_list.SendCount = 2;
+	send_list.pSends = sends;
+
 	// create a source voice
 	FAudioWaveFormatEx waveFormat;
 	waveFormat.wFormatTag = 3;
@@ -75,13 +461,14 @@ AudioVoice *faudio_create_voice(AudioContext *p_context, float *p_buffer, size_t
 	waveFormat.cbSize = 0;
 
 	FAudioSourceVoice *voice;
-	hr = FAudio_CreateSourceVoice(p_context->faudio, &voice, &waveFormat, FAUDIO_VOICE_USEFILTER, FAUDIO_MAX_FREQ_RATIO, NULL, NULL, &p_context->effect_chain);
+	uint32_t hr = FAudio_CreateSourceVoice(p_context->faudio, &voice, &waveFormat, FAUDIO_VOICE_USEFILTER, FAUDIO_MAX_FREQ_RATIO, NULL, &send_list, NULL);
 
 	if (hr != 0) {
 		return nullptr;
 	}
 
 	FAudioVoice_SetVolume(voice, 1.0f, FAUDIO_COMMIT_NOW);
+	p_context->frequency = 1.0f;
 	
 	// submit the array
 	p_context->buffer = { 0 };
@@ -94,98 +481,282 @@ AudioVoice *faudio_create_voice(AudioContext *p_context, float *p_buffer, size_t
 	p_context->buffer.LoopLength = 0;
 	p_context->buffer.LoopCount = 0;
 
-	
-	size_t silence_len = 2 * 48000 * p_num_channels;
-	float *silence_buffer = new float[silence_len];
-	for (uint32_t i = 0; i < silence_len; ++i)
-	{
-		silence_buffer[i] = 0.0f;
-	}
-
-	p_context->silence = { 0 };
-	p_context->silence.AudioBytes = 4 * silence_len;
-	p_context->silence.pAudioData = (uint8_t *)silence_buffer;
-	p_context->silence.Flags = FAUDIO_END_OF_STREAM;
-	p_context->silence.PlayBegin = 0;
-	p_context->silence.PlayLength = silence_len / p_num_channels;
-	p_context->silence.LoopBegin = 0;
-	p_context->silence.LoopLength = 0;
-	p_context->silence.LoopCount = 0;
+	// (re)allocate the silence that lets the reverb tail ring out, faudio_wave_play sizes it for the tail mode
+	faudio_silence_resize(p_context, p_num_channels, FAUDIO_FIXED_SILENCE_FRAMES);
 
 	// return a voice struct
 	AudioVoice *result = new AudioVoice();
 	result->context = p_context;
 	result->voice = voice;
-	return result;
-}
+	result->channels = p_num_channels;
 
-void faudio_reverb_set_params(AudioContext *context)
-{
-	FAudioVoice_SetEffectParameters(context->voice->voice, 0, &context->reverb_params, sizeof(context->reverb_params), FAUDIO_COMMIT_NOW);
+	FAudioVoice_GetOutputMatrix(voice, p_context->reverb_bus, p_num_channels, p_context->bus_channels, result->bus_matrix);
+	FAudioVoice_GetOutputMatrix(voice, p_context->mastering_voice, p_num_channels, p_context->output_5p1 ? 6 : 2, result->master_matrix);
+	faudio_voice_set_send_level(result, 1.0f);
+
+	return result;
 }
 
 void faudio_voice_destroy(AudioVoice *p_voice)
 {
 	FAudioVoice_DestroyVoice(p_voice->voice);
+	delete p_voice;
 }
 
 void faudio_voice_set_volume(AudioVoice *p_voice, float p_volume)
 {
-	FAudioVoice_SetVolume(p_voice->voice, p_volume, FAUDIO_COMMIT_NOW);
+	FAudioVoice_SetVolume(p_voice->voice, p_volume, p_voice->context->operation_set);
+	p_voice->context->operation_changed = true;
 }
 
 void faudio_voice_set_frequency(AudioVoice *p_voice, float p_frequency)
 {
-	FAudioSourceVoice_SetFrequencyRatio(p_voice->voice, p_frequency, FAUDIO_COMMIT_NOW);
+	FAudioSourceVoice_SetFrequencyRatio(p_voice->voice, p_frequency, p_voice->context->operation_set);
+	p_voice->context->operation_changed = true;
+	p_voice->context->frequency = p_frequency;
 }
 
 void faudio_wave_load(AudioContext *p_context, AudioSampleWave sample, bool stereo)
 {
+	std::lock_guard<std::mutex> lock(p_context->tail_lock);
+
 	if (p_context->voice)
 	{
 		audio_voice_destroy(p_context->voice);
+		p_context->voice = NULL;
 	}
 
+	drwav_free(p_context->wav_samples);
+
 	p_context->wav_samples = drwav_open_and_read_file_f32(
 		(!stereo) ? audio_sample_filenames[sample] : audio_stereo_filenames[sample],
 		&p_context->wav_channels,
 		&p_context->wav_samplerate,
 		&p_context->wav_sample_count);
 
+	if (p_context->wav_samples == NULL)
+	{
+		return;
+	}
+
 	p_context->wav_sample_count /= p_context->wav_channels;
 
+	// the bus takes the channel count of the wave, a tail still ringing on it carries on into the new sample
+	if (p_context->reverb_bus == NULL || p_context->bus_channels != p_context->wav_channels)
+	{
+		faudio_bus_create(p_context, p_context->wav_channels);
+	}
+
 	p_context->voice = audio_create_voice(p_context, p_context->wav_samples, p_context->wav_sample_count, p_context->wav_samplerate, p_context->wav_channels);
-	faudio_reverb_set_params(p_context);
 }
 
-void faudio_wave_play(AudioContext *p_context)
+// restarts the voice with the events of p_events, none for a plain audio_wave_play
+static void faudio_voice_start(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count)
 {
+	p_context->probe.begin(AudioTrigger_WavePlay);
+
+	std::unique_lock<std::mutex> lock(p_context->tail_lock);
+
 	FAudioSourceVoice_Stop(p_context->voice->voice, 0, FAUDIO_COMMIT_NOW);
 	FAudioSourceVoice_FlushSourceBuffers(p_context->voice->voice);
 
+	// the silence after the sample runs at the source rate, a tail of 0 (effect disabled) needs none
+	size_t silence_frames = FAUDIO_FIXED_SILENCE_FRAMES;
+
+	if (p_context->tail_mode == AudioTailMode_Decay)
+	{
+		float seconds = audio_tail_seconds(p_context->reverb_enabled, &p_context->reverb_params);
+		silence_frames = (size_t) (seconds * p_context->wav_samplerate * p_context->frequency);
+		p_context->tail_hold_frames = audio_tail_hold_frames(&p_context->reverb_params);
+		p_context->tail.reset();
+	}
+
 	FAudioSourceVoice_SubmitSourceBuffer(p_context->voice->voice, &p_context->buffer, NULL);
-	FAudioSourceVoice_SubmitSourceBuffer(p_context->voice->voice, &p_context->silence, NULL);
+
+	if (silence_frames > 0)
+	{
+		faudio_silence_resize(p_context, p_context->wav_channels, silence_frames);
+		FAudioSourceVoice_SubmitSourceBuffer(p_context->voice->voice, &p_context->silence, NULL);
+	}
+
+	// the voice starts with the next pass, the first pass end from now on applies the events of its first pass
 	FAudioSourceVoice_Start(p_context->voice->voice, 0, FAUDIO_COMMIT_NOW);
+	p_context->automation.start(p_events, p_count);
+	p_context->bus_restore = true;
+	lock.unlock();
+
+	p_context->probe.arm(AudioTrigger_WavePlay);
 }
 
-void faudio_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params)
+void faudio_wave_play(AudioContext *p_context)
 {
-	if (p_context->reverb_enabled && !p_enabled)
+	if (p_context->voice == NULL)
 	{
-		FAudioVoice_DisableEffect(p_context->voice->voice, 0, FAUDIO_COMMIT_NOW);
-		p_context->reverb_enabled = p_enabled;
+		return;
 	}
-	else if (!p_context->reverb_enabled && p_enabled)
+
+	faudio_voice_start(p_context, NULL, 0);
+}
+
+bool faudio_automation_play(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count)
+{
+	if (p_context->voice == NULL)
 	{
-		FAudioVoice_EnableEffect(p_context->voice->voice, 0, FAUDIO_COMMIT_NOW);
-		p_context->reverb_enabled = p_enabled;
+		return false;
 	}
 
+	faudio_voice_start(p_context, p_events, p_count);
+	return true;
+}
+
+bool faudio_wave_playing(AudioContext *p_context)
+{
+	if (p_context->voice == NULL)
+	{
+		return false;
+	}
+
+	FAudioVoiceState state;
+	FAudioSourceVoice_GetState(p_context->voice->voice, &state, FAUDIO_VOICE_NOSAMPLESPLAYED);
+	return state.BuffersQueued > 0;
+}
+
+bool faudio_set_tail_mode(AudioContext *p_context, AudioTailMode p_mode)
+{
+	std::lock_guard<std::mutex> lock(p_context->tail_lock);
+
+	// a voice that already plays keeps its silence, but is checked for the end of its tail from now on
+	p_context->tail_hold_frames = audio_tail_hold_frames(&p_context->reverb_params);
+	p_context->tail.reset();
+	p_context->tail_mode = p_mode;
+	return true;
+}
+
+// posts the state of the effect together with the operation sets of all batches so far. A post with a changed effect
+//	arms the probe, which waits for the mixer to apply it.
+static void faudio_effect_post(AudioContext *p_context)
+{
+	p_context->effect_serial++;
+
+	if (p_context->effect_changed)
+	{
+		p_context->probe.arm_posted(AudioTrigger_EffectChange, p_context->effect_serial);
+		p_context->effect_changed = false;
+	}
+
+	FAudioEffectMessage message;
+	message.serial = p_context->effect_serial;
+	message.enabled = p_context->reverb_enabled;
+	message.params = p_context->reverb_params;
+	message.params_serial = p_context->params_serial;
+	message.morph_frames = p_context->morph_frames;
+	message.commit_through = p_context->operation_last;
+	p_context->effect_mailbox.publish(message);
+}
+
+void faudio_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params, uint32_t p_changed)
+{
+	p_context->probe.begin(AudioTrigger_EffectChange);
+
+	p_context->reverb_enabled = p_enabled;
 	p_context->reverb_params = *p_params;
-	faudio_reverb_set_params(p_context);
+	p_context->params_serial++;
+	p_context->morph_frames = 0;
+	p_context->effect_changed = true;
+
+	if (p_context->operation_set == FAUDIO_COMMIT_NOW)
+		faudio_effect_post(p_context);
+	else
+		p_context->operation_changed = true;
+}
+
+void faudio_effect_morph(AudioContext *p_context, const ReverbParameters *p_target, float p_seconds)
+{
+	p_context->probe.begin(AudioTrigger_EffectChange);
+
+	p_context->reverb_params = *p_target;
+	p_context->params_serial++;
+	p_context->morph_frames = (uint32_t) fmaxf(p_seconds * AUDIO_MASTER_SAMPLERATE + 0.5f, 0.0f);
+	p_context->effect_changed = true;
+
+	if (p_context->operation_set == FAUDIO_COMMIT_NOW)
+		faudio_effect_post(p_context);
+	else
+		p_context->operation_changed = true;
+}
+
+void faudio_begin_changes(AudioContext *p_context)
+{
+	if (p_context->operation_set == FAUDIO_COMMIT_NOW)
+	{
+		p_context->operation_set = faudio_operation_set_next(p_context->operation_last);
+		p_context->operation_changed = false;
+	}
+}
+
+void faudio_commit_changes(AudioContext *p_context)
+{
+	if (p_context->operation_set == FAUDIO_COMMIT_NOW)
+		return;
+
+	// an empty batch leaves its set number to the next one
+	if (p_context->operation_changed)
+	{
+		// committing the set here could apply it a pass before the effect, the mixer commits it along with the effect
+		p_context->operation_last = p_context->operation_set;
+		faudio_effect_post(p_context);
+	}
+
+	p_context->operation_set = FAUDIO_COMMIT_NOW;
+}
+
+double faudio_trigger_latency(AudioContext *p_context, AudioTrigger p_trigger)
+{
+	return p_context->probe.latency(p_trigger);
+}
+
+size_t faudio_bytes_in_use(AudioContext *p_context)
+{
+	size_t result = sizeof(AudioContext);
+
+	if (p_context->wav_samples)
+		result += p_context->wav_sample_count * p_context->wav_channels * sizeof(float);
+	if (p_context->silence_samples)
+		result += p_context->silence_frames * p_context->silence_channels * sizeof(float);
+	if (p_context->voice)
+		result += sizeof(AudioVoice);
+
+	return result;
 }
 
-AudioContext *faudio_create_context(bool output_5p1)
+size_t faudio_render(AudioContext *p_context, float *p_output, size_t p_frames)
+{
+	// FAudio renders on its own thread straight to the device
+	return 0;
+}
+
+size_t faudio_quantum_times(AudioContext *p_context, float *p_times, size_t p_max)
+{
+	return p_context->quantum_times.copy(p_times, p_max);
+}
+
+uint32_t faudio_quantum_frames(AudioContext *p_context)
+{
+	return p_context->quantum_frames;
+}
+
+bool faudio_effect_set_mode(AudioContext *p_context, AudioEffectMode p_mode)
+{
+	return p_mode == AudioEffectMode_Algorithmic;
+}
+
+size_t faudio_effect_mode_times(AudioContext *p_context, AudioEffectMode p_mode, float *p_times, size_t p_max)
+{
+	// the reverb runs inside FAudio, it isn't timed on its own
+	return 0;
+}
+
+AudioContext *faudio_create_context(bool output_5p1, uint32_t p_quantum)
 {
 	// setup function pointers
 	audio_destroy_context = faudio_destroy_context;
@@ -193,36 +764,121 @@ AudioContext *faudio_create_context(bool output_5p1)
 	audio_voice_destroy = faudio_voice_destroy;
 	audio_voice_set_volume = faudio_voice_set_volume;
 	audio_voice_set_frequency = faudio_voice_set_frequency;
+	audio_voice_set_send_level = faudio_voice_set_send_level;
 
 	audio_wave_load = faudio_wave_load;
 	audio_wave_play = faudio_wave_play;
+	audio_wave_playing = faudio_wave_playing;
+	audio_automation_play = faudio_automation_play;
+	audio_set_tail_mode = faudio_set_tail_mode;
 
 	audio_effect_change = faudio_effect_change;
+	audio_effect_morph = faudio_effect_morph;
+	audio_effect_set_mode = faudio_effect_set_mode;
+	audio_effect_mode_times = faudio_effect_mode_times;
+	audio_begin_changes = faudio_begin_changes;
+	audio_commit_changes = faudio_commit_changes;
+
+	audio_render = faudio_render;
+	audio_trigger_latency = faudio_trigger_latency;
+	audio_bytes_in_use = faudio_bytes_in_use;
+	audio_quantum_times = faudio_quantum_times;
+	audio_quantum_frames = faudio_quantum_frames;
+
+	// FAudio mixes 10 ms, or 21.33 ms with FAUDIO_1024_QUANTUM: take the one closer to the request
+	uint32_t flags = 0;
+	uint32_t quantum_frames = AUDIO_DEFAULT_QUANTUM;
+
+	#ifdef FAUDIO_1024_QUANTUM
+	if (p_quantum > (AUDIO_DEFAULT_QUANTUM + AUDIO_LONG_QUANTUM) / 2)
+	{
+		flags |= FAUDIO_1024_QUANTUM;
+		quantum_frames = AUDIO_LONG_QUANTUM;
+	}
+	#endif
 
 	// create Faudio object
 	FAudio *faudio;
 
-	uint32_t hr = FAudioCreate(&faudio, 0, FAUDIO_DEFAULT_PROCESSOR);
+	uint32_t hr = FAudioCreate(&faudio, flags, FAUDIO_DEFAULT_PROCESSOR);
+	if (hr != 0)
+		return nullptr;
+
+	// create a volume meter to observe the output of the mastering voice
+	void *meter = nullptr;
+
+	hr = FAudioCreateVolumeMeter(&meter, 0);
 	if (hr != 0)
+	{
+		FAudio_Release(faudio);
 		return nullptr;
+	}
+
+	FAudioEffectDescriptor meter_effect;
+	meter_effect.InitialState = 1;
+	meter_effect.OutputChannels = output_5p1 ? 6 : 2;
+	meter_effect.pEffect = meter;
+
+	FAudioEffectChain meter_chain;
+	meter_chain.EffectCount = 1;
+	meter_chain.pEffectDescriptors = &meter_effect;
 
 	// create a mastering voice
 	FAudioMasteringVoice *mastering_voice;
 
-	hr = FAudio_CreateMasteringVoice(faudio, &mastering_voice, output_5p1 ? 6 : 2, 44100, 0, 0, NULL);
+	hr = FAudio_CreateMasteringVoice(faudio, &mastering_voice, output_5p1 ? 6 : 2, AUDIO_MASTER_SAMPLERATE, 0, 0, &meter_chain);
+
+	// the voice holds its own reference to the meter
+	((FAPO *) meter)->Release(meter);
+
 	if (hr != 0)
+	{
+		FAudio_Release(faudio);
 		return nullptr;
+	}
 
-	// return a context object
+	// fill in the context object, only once nothing can fail anymore
 	AudioContext *context = new AudioContext();
 	context->faudio = faudio;
 	context->output_5p1 = output_5p1;
 	context->mastering_voice = mastering_voice;
+	context->quantum_frames = quantum_frames;
+
+	context->engine_callback.callback.OnCriticalError = NULL;
+	context->engine_callback.callback.OnProcessingPassStart = faudio_on_pass_start;
+	context->engine_callback.callback.OnProcessingPassEnd = faudio_on_pass_end;
+	context->engine_callback.context = context;
+	FAudio_RegisterForCallbacks(faudio, &context->engine_callback.callback);
 
 	context->voice = NULL;
+	context->reverb_bus = NULL;
+	context->bus_channels = 0;
 	context->wav_samples = NULL;
+	context->silence_samples = NULL;
+	context->silence_channels = 0;
+	context->silence_frames = 0;
+	context->frequency = 1.0f;
+	context->tail_mode = AudioTailMode_Fixed;
+	context->tail_hold_frames = 0;
 	context->reverb_params = { 0 };
 	context->reverb_enabled = false;
+	context->params_serial = 0;
+	context->morph_frames = 0;
+	context->effect_serial = 0;
+	context->effect_changed = false;
+	context->bus_effect_enabled = false;
+	context->bus_effect_params = { 0 };
+	context->bus_params_serial = 0;
+	context->bus_posted_enabled = false;
+	context->bus_posted_params = { 0 };
+	context->bus_automated = false;
+	context->bus_restore = false;
+	context->bus_morph_frames = 0;
+	context->bus_morph_position = 0;
+	context->operation_set = FAUDIO_COMMIT_NOW;
+	context->operation_last = 0;
+	context->operation_changed = false;
+	context->operation_committed = 0;
 
 	// load the first wave
 	audio_wave_load(context, (AudioSampleWave) 0, false);
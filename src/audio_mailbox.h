@@ -0,0 +1,46 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_MAILBOX_H
+#define FAUDIOFILTERDEMO_AUDIO_MAILBOX_H
+
+#include <atomic>
+
+// hands the latest value from one producer thread to one consumer thread without either of them ever waiting (a triple
+//	buffer). The producer fills its own slot and swaps it with the shared one, the consumer swaps the shared slot with
+//	its own when it holds a newer value. Values published in between two fetches are dropped, only the latest counts:
+//	the API thread posts every change of the effect, the mixer picks up the current state once per quantum.
+
+template <typename T>
+class AudioMailbox
+{
+	public :
+		AudioMailbox() : m_front(0), m_middle(1), m_back(2)
+		{
+		}
+
+		// producer
+		void publish(const T &p_value)
+		{
+			m_slots[m_back] = p_value;
+			m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+		}
+
+		// consumer: the latest value published since the last fetch, or null. The value stays valid until the next fetch.
+		const T *fetch()
+		{
+			if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+				return nullptr;
+
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+			return &m_slots[m_front];
+		}
+
+	private :
+		static const unsigned int INDEX = 3;
+		static const unsigned int FRESH = 4;		// the shared slot holds a value the consumer hasn't seen
+
+		T							m_slots[3];
+		unsigned int				m_front;		// owned by the consumer
+		std::atomic<unsigned int>	m_middle;
+		unsigned int				m_back;			// owned by the producer
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_MAILBOX_H
@@ -0,0 +1,647 @@
+#include "audio_mixer.h"
+
+#include <math.h>
+#include <string.h>
+
+void audio_mixer_default_matrix(unsigned int p_src_channels, unsigned int p_dst_channels, float *p_matrix)
+{
+	memset(p_matrix, 0, sizeof(float) * p_src_channels * p_dst_channels);
+
+	if (p_src_channels == 1)
+	{
+		p_matrix[0] = 1.0f;
+		p_matrix[1] = 1.0f;
+	}
+	else
+	{
+		p_matrix[0 * p_src_channels + 0] = 1.0f;
+		p_matrix[1 * p_src_channels + 1] = 1.0f;
+	}
+}
+
+// source frames the voice runs after the end of its sample
+static double audio_mixer_voice_tail_frames(AudioMixerVoice *p_voice)
+{
+	AudioMixer *mixer = p_voice->mixer;
+
+	if (mixer->tail_mode == AudioTailMode_Fixed)
+		return (double) AUDIO_MIXER_TAIL_FRAMES;
+
+	return (double) audio_tail_seconds(mixer->reverb_enabled, &mixer->reverb_params) * p_voice->sample_rate * p_voice->frequency;
+}
+
+// resamples the voice and mixes it into the sends of the bus, the rest straight into the master
+static void audio_mixer_voice_render(AudioMixerVoice *p_voice, float *p_output, float *p_bus, uint32_t p_frames)
+{
+	AudioMixer *mixer = p_voice->mixer;
+	unsigned int src_channels = p_voice->num_channels;
+	unsigned int bus_channels = mixer->bus_channels;
+	double end_position = (double) p_voice->buffer_size + audio_mixer_voice_tail_frames(p_voice);
+	double step = (double) p_voice->frequency * p_voice->sample_rate / AUDIO_MASTER_SAMPLERATE;
+
+	// resample the source into the voice buffer
+	float *source = p_voice->source_buffer.data();
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		size_t idx = (size_t) p_voice->position;
+		float frac = (float) (p_voice->position - (double) idx);
+
+		for (unsigned int ch = 0; ch < src_channels; ++ch)
+		{
+			float s0 = (idx < p_voice->buffer_size) ? p_voice->buffer[idx * src_channels + ch] : 0.0f;
+			float s1 = (idx + 1 < p_voice->buffer_size) ? p_voice->buffer[(idx + 1) * src_channels + ch] : 0.0f;
+			source[frame * src_channels + ch] = s0 + (s1 - s0) * frac;
+		}
+
+		p_voice->position += step;
+	}
+
+	if (p_voice->position >= end_position)
+	{
+		p_voice->playing = false;
+	}
+
+	// send to the bus, a voice with a different channel count than the bus repeats its last channel
+	float send = p_voice->volume * p_voice->send_level;
+	float direct = p_voice->volume * (1.0f - p_voice->send_level);
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		for (unsigned int ch = 0; ch < bus_channels; ++ch)
+		{
+			unsigned int src = (ch < src_channels) ? ch : src_channels - 1;
+			p_bus[frame * bus_channels + ch] += source[frame * src_channels + src] * send;
+		}
+	}
+
+	// the rest goes to the master output
+	if (direct != 0.0f)
+	{
+		float matrix[6 * 2];
+		audio_mixer_default_matrix(src_channels, mixer->output_channels, matrix);
+
+		for (uint32_t frame = 0; frame < p_frames; ++frame)
+		{
+			for (unsigned int dst = 0; dst < mixer->output_channels; ++dst)
+			{
+				float sum = 0.0f;
+
+				for (unsigned int src = 0; src < src_channels; ++src)
+				{
+					sum += matrix[dst * src_channels + src] * source[frame * src_channels + src];
+				}
+
+				p_output[frame * mixer->output_channels + dst] += sum * direct;
+			}
+		}
+	}
+}
+
+// mixer side: takes over the latest posted state at the start of a quantum
+static void audio_mixer_effect_receive(AudioMixer *p_mixer)
+{
+	const AudioMixerMessage *message = p_mixer->effect_mailbox.fetch();
+
+	if (message == NULL)
+		return;
+
+	p_mixer->reverb_enabled = message->enabled;
+	p_mixer->effect_mode = message->mode;
+	p_mixer->effect_data = message->effect_data;
+	p_mixer->posted_enabled = message->enabled;
+	p_mixer->posted_params = message->params;
+
+	if (message->params_serial != p_mixer->params_serial)
+	{
+		p_mixer->params_serial = message->params_serial;
+		p_mixer->morph_frames = message->morph_frames;
+
+		if (message->morph_frames > 0)
+		{
+			// from the step the reverb is at, a morph replaces the one still running
+			p_mixer->morph_from = p_mixer->reverb_params;
+			p_mixer->morph_to = message->params;
+			p_mixer->morph_position = 0;
+		}
+		else if (audio_reverb_changed_fields(&p_mixer->reverb_params, &message->params) != 0)
+		{
+			// toggling the effect leaves the reverb as it is, new parameters make it recompute its state
+			p_mixer->reverb_params = message->params;
+			p_mixer->effect.set_params(p_mixer, &p_mixer->reverb_params);
+		}
+	}
+
+	p_mixer->effect_received.store(message->serial, std::memory_order_release);
+	p_mixer->probe.applied(message->serial);
+}
+
+// mixer side: moves a running morph on by p_frames and gives the effect the parameters those frames are processed with.
+//	The last step lands exactly on the target.
+static void audio_mixer_morph_advance(AudioMixer *p_mixer, uint32_t p_frames)
+{
+	if (p_mixer->morph_frames == 0)
+		return;
+
+	p_mixer->morph_position += p_frames;
+
+	if (p_mixer->morph_position >= p_mixer->morph_frames)
+	{
+		p_mixer->reverb_params = p_mixer->morph_to;
+		p_mixer->morph_frames = 0;
+	}
+	else
+	{
+		float amount = (float) p_mixer->morph_position / (float) p_mixer->morph_frames;
+		audio_reverb_interpolate(&p_mixer->morph_from, &p_mixer->morph_to, amount, &p_mixer->reverb_params);
+	}
+
+	p_mixer->effect.set_params(p_mixer, &p_mixer->reverb_params);
+}
+
+// runs the effect once on the sends of all voices, for p_frames from frame p_offset of the quantum on. Without the effect
+//	the first and the last channel of the bus go to front left / right.
+static void audio_mixer_bus_render(AudioMixer *p_mixer, float *p_output, uint32_t p_offset, uint32_t p_frames)
+{
+	unsigned int bus_channels = p_mixer->bus_channels;
+	unsigned int dst_channels = p_mixer->output_channels;
+	const float *bus = p_mixer->bus_buffer.data() + p_offset * bus_channels;
+	float *effect = p_mixer->effect_buffer.data() + p_offset * dst_channels;
+
+	p_output += p_offset * dst_channels;
+
+	if (p_mixer->reverb_enabled)
+	{
+		AudioTimingHistory &effect_time = p_mixer->effect_mode_times[p_mixer->effect_mode];
+
+		// while morphing the parameters change every morph_step frames within the quantum. The convolution mode uses the
+		//	response of the target right away, it runs in one part.
+		uint32_t step = p_frames;
+
+		if (p_mixer->morph_frames > 0 && p_mixer->effect_mode == AudioEffectMode_Algorithmic)
+			step = p_mixer->effect.morph_step;
+
+		effect_time.start();
+
+		for (uint32_t offset = 0; offset < p_frames; offset += step)
+		{
+			uint32_t frames = (p_frames - offset < step) ? p_frames - offset : step;
+
+			audio_mixer_morph_advance(p_mixer, frames);
+			p_mixer->effect.process(p_mixer, bus + offset * bus_channels, effect + offset * dst_channels, frames);
+		}
+
+		effect_time.stop();
+
+		for (uint32_t idx = 0; idx < p_frames * dst_channels; ++idx)
+		{
+			p_output[idx] += effect[idx];
+		}
+	}
+	else
+	{
+		audio_mixer_morph_advance(p_mixer, p_frames);
+
+		for (uint32_t frame = 0; frame < p_frames; ++frame)
+		{
+			p_output[frame * dst_channels + 0] += bus[frame * bus_channels + 0];
+			p_output[frame * dst_channels + 1] += bus[frame * bus_channels + bus_channels - 1];
+		}
+	}
+}
+
+// mixer side: sets the effect to a state at once, e.g. for an event of the automation like a change posted by the API at
+//	exactly this frame. It ends a running morph, the effect takes new parameters over with the next frames it processes.
+static void audio_mixer_effect_apply(AudioMixer *p_mixer, bool p_enabled, const ReverbParameters *p_params)
+{
+	p_mixer->reverb_enabled = p_enabled;
+	p_mixer->morph_frames = 0;
+
+	if (audio_reverb_changed_fields(&p_mixer->reverb_params, p_params) != 0)
+	{
+		p_mixer->reverb_params = *p_params;
+		p_mixer->effect.set_params(p_mixer, &p_mixer->reverb_params);
+	}
+}
+
+// the bus for the whole quantum, in parts between the events of the automation
+static void audio_mixer_bus_render_automated(AudioMixer *p_mixer, float *p_output)
+{
+	AudioAutomationCursor &automation = p_mixer->automation;
+	uint32_t offset = 0;
+
+	while (offset < p_mixer->quantum_frames)
+	{
+		while (const AudioAutomationEvent *event = automation.take(1))
+		{
+			audio_mixer_effect_apply(p_mixer, event->enabled, &event->params);
+			p_mixer->effect_automated = true;
+		}
+
+		uint32_t frames = automation.frames_to_next(p_mixer->quantum_frames - offset);
+
+		audio_mixer_bus_render(p_mixer, p_output, offset, frames);
+		automation.advance(frames);
+		offset += frames;
+	}
+}
+
+static void audio_mixer_render_quantum(AudioMixer *p_mixer)
+{
+	float *mix = p_mixer->mix_buffer.data();
+	memset(mix, 0, sizeof(float) * p_mixer->mix_buffer.size());
+
+	audio_mixer_effect_receive(p_mixer);
+
+	p_mixer->probe.pass_start();
+	p_mixer->quantum_times.start();
+
+	AudioMixerVoice *voice = p_mixer->voice;
+
+	// the bus only runs while a voice plays, the silence after a sample keeps the voice playing until the tail rang out
+	if (voice && voice->playing)
+	{
+		bool tail_only = voice->position >= (double) voice->buffer_size;
+
+		memset(p_mixer->bus_buffer.data(), 0, sizeof(float) * p_mixer->bus_buffer.size());
+		audio_mixer_voice_render(voice, mix, p_mixer->bus_buffer.data(), p_mixer->quantum_frames);
+
+		if (p_mixer->automation.active())
+			audio_mixer_bus_render_automated(p_mixer, mix);
+		else
+			audio_mixer_bus_render(p_mixer, mix, 0, p_mixer->quantum_frames);
+
+		// tail-aware playback: once only the tail is left, stop as soon as it died out instead of running to the end of
+		//	the silence. Without the effect there is no silence, the voice ends with its sample.
+		if (p_mixer->tail_mode == AudioTailMode_Decay && tail_only && p_mixer->reverb_enabled)
+		{
+			float peak = audio_tail_peak(p_mixer->effect_buffer.data(), p_mixer->quantum_frames * p_mixer->output_channels);
+
+			if (voice->tail.decayed(peak, p_mixer->quantum_frames, audio_tail_hold_frames(&p_mixer->reverb_params)))
+				voice->playing = false;
+		}
+	}
+	else
+	{
+		// a morph runs in time, also while nothing plays
+		audio_mixer_morph_advance(p_mixer, p_mixer->quantum_frames);
+	}
+
+	p_mixer->quantum_times.stop();
+
+	bool audible = false;
+	for (size_t idx = 0; idx < p_mixer->mix_buffer.size() && !audible; ++idx)
+	{
+		audible = mix[idx] != 0.0f;
+	}
+
+	p_mixer->probe.pass_end(audible);
+	p_mixer->mix_offset = 0;
+}
+
+void audio_mixer_init(AudioMixer *p_mixer, const AudioMixerEffect &p_effect, bool p_output_5p1, uint32_t p_quantum)
+{
+	p_mixer->effect = p_effect;
+	p_mixer->output_5p1 = p_output_5p1;
+	p_mixer->output_channels = p_output_5p1 ? 6 : 2;
+
+	p_mixer->voice = NULL;
+	p_mixer->wav_samples = NULL;
+	p_mixer->bus_channels = 0;
+	p_mixer->reverb_params = audio_reverb_presets[0];
+	p_mixer->params_serial = 0;
+	p_mixer->reverb_enabled = false;
+	p_mixer->effect_mode = AudioEffectMode_Algorithmic;
+	p_mixer->effect_data = NULL;
+	p_mixer->tail_mode = AudioTailMode_Fixed;
+	p_mixer->morph_frames = 0;
+	p_mixer->morph_position = 0;
+	p_mixer->posted_enabled = p_mixer->reverb_enabled;
+	p_mixer->posted_params = p_mixer->reverb_params;
+	p_mixer->effect_automated = false;
+
+	p_mixer->effect_received = 0;
+	p_mixer->effect_requested.serial = 0;
+	p_mixer->effect_requested.enabled = p_mixer->reverb_enabled;
+	p_mixer->effect_requested.mode = p_mixer->effect_mode;
+	p_mixer->effect_requested.params = p_mixer->reverb_params;
+	p_mixer->effect_requested.params_serial = 0;
+	p_mixer->effect_requested.morph_frames = 0;
+	p_mixer->effect_requested.effect_data = NULL;
+	p_mixer->effect_fields = AudioReverbField_All;
+	p_mixer->effect_changed = false;
+	p_mixer->effect_batch = false;
+	p_mixer->effect_batch_changed = false;
+
+	p_mixer->quantum_frames = p_quantum;
+	p_mixer->mix_buffer.resize(p_mixer->quantum_frames * p_mixer->output_channels);
+	p_mixer->mix_offset = p_mixer->quantum_frames;
+	p_mixer->effect_buffer.resize(p_mixer->quantum_frames * p_mixer->output_channels);
+}
+
+void audio_mixer_release(AudioMixer *p_mixer)
+{
+	if (p_mixer->voice)
+	{
+		audio_voice_destroy((AudioVoice *) p_mixer->voice);
+		p_mixer->voice = NULL;
+	}
+
+	drwav_free(p_mixer->wav_samples);
+	p_mixer->wav_samples = NULL;
+}
+
+static void audio_mixer_publish(AudioMixer *p_mixer)
+{
+	AudioMixerMessage &request = p_mixer->effect_requested;
+
+	request.serial++;
+
+	if (p_mixer->effect.prepare != NULL)
+		p_mixer->effect.prepare(p_mixer, &request);
+
+	// a changed effect is measured from the call to the first quantum that took this post
+	if (p_mixer->effect_changed)
+	{
+		p_mixer->probe.arm_posted(AudioTrigger_EffectChange, request.serial);
+		p_mixer->effect_changed = false;
+	}
+
+	p_mixer->effect_mailbox.publish(request);
+}
+
+void audio_mixer_post(AudioMixer *p_mixer)
+{
+	if (!p_mixer->effect_batch)
+		audio_mixer_publish(p_mixer);
+	else
+		p_mixer->effect_batch_changed = true;
+}
+
+size_t audio_mixer_bytes_in_use(AudioMixer *p_mixer)
+{
+	size_t result = p_mixer->mix_buffer.capacity() * sizeof(float);
+
+	result += p_mixer->bus_buffer.capacity() * sizeof(float);
+	result += p_mixer->effect_buffer.capacity() * sizeof(float);
+
+	if (p_mixer->wav_samples)
+		result += p_mixer->wav_sample_count * p_mixer->wav_channels * sizeof(float);
+
+	if (p_mixer->voice)
+	{
+		result += sizeof(AudioMixerVoice);
+		result += p_mixer->voice->source_buffer.capacity() * sizeof(float);
+	}
+
+	return result;
+}
+
+AudioVoice *audio_mixer_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	// return a voice struct, it sends to the reverb bus of the context
+	AudioMixerVoice *result = new AudioMixerVoice();
+	result->mixer = mixer;
+	result->buffer = p_buffer;
+	result->buffer_size = p_buffer_size;
+	result->sample_rate = p_sample_rate;
+	result->num_channels = p_num_channels;
+	result->volume = 1.0f;
+	result->frequency = 1.0f;
+	result->send_level = 1.0f;
+	result->playing = false;
+	result->position = 0.0;
+	result->source_buffer.resize(mixer->quantum_frames * p_num_channels);
+	return (AudioVoice *) result;
+}
+
+void audio_mixer_voice_destroy(AudioVoice *p_voice)
+{
+	AudioMixerVoice *voice = (AudioMixerVoice *) p_voice;
+
+	delete voice;
+}
+
+void audio_mixer_voice_set_volume(AudioVoice *p_voice, float p_volume)
+{
+	AudioMixerVoice *voice = (AudioMixerVoice *) p_voice;
+
+	voice->volume = p_volume;
+}
+
+void audio_mixer_voice_set_frequency(AudioVoice *p_voice, float p_frequency)
+{
+	AudioMixerVoice *voice = (AudioMixerVoice *) p_voice;
+
+	voice->frequency = p_frequency;
+}
+
+void audio_mixer_voice_set_send_level(AudioVoice *p_voice, float p_level)
+{
+	AudioMixerVoice *voice = (AudioMixerVoice *) p_voice;
+
+	voice->send_level = fminf(fmaxf(p_level, 0.0f), 1.0f);
+}
+
+void audio_mixer_wave_load(AudioContext *p_context, AudioSampleWave sample, bool stereo)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	audio_mixer_release(mixer);
+
+	mixer->wav_samples = drwav_open_and_read_file_f32(
+		(!stereo) ? audio_sample_filenames[sample] : audio_stereo_filenames[sample],
+		&mixer->wav_channels,
+		&mixer->wav_samplerate,
+		&mixer->wav_sample_count);
+
+	if (mixer->wav_samples == NULL)
+	{
+		return;
+	}
+
+	mixer->wav_sample_count /= mixer->wav_channels;
+
+	// the new sample starts on a silent bus, like it did when every voice brought its own reverb
+	mixer->bus_channels = mixer->effect.reset(mixer, mixer->wav_channels);
+
+	if (mixer->bus_channels == 0)
+	{
+		return;
+	}
+
+	mixer->bus_buffer.resize(mixer->quantum_frames * mixer->bus_channels);
+	mixer->voice = (AudioMixerVoice *) audio_create_voice(p_context, mixer->wav_samples, mixer->wav_sample_count, mixer->wav_samplerate, mixer->wav_channels);
+}
+
+// restarts the voice with the events of p_events, none for a plain audio_wave_play
+static void audio_mixer_voice_start(AudioMixer *p_mixer, const AudioAutomationEvent *p_events, size_t p_count)
+{
+	p_mixer->probe.begin(AudioTrigger_WavePlay);
+
+	// restart from the beginning of the sample, the effect keeps ringing like it does on a real voice
+	p_mixer->voice->position = 0.0;
+	p_mixer->voice->playing = true;
+	p_mixer->voice->tail.reset();
+	p_mixer->automation.start(p_events, p_count);
+
+	// the caller keeps the mixer out while the voice restarts, so the effect can go back to the posted state right here
+	//	instead of running on with the last event of the previous replay
+	if (p_mixer->effect_automated)
+	{
+		audio_mixer_effect_apply(p_mixer, p_mixer->posted_enabled, &p_mixer->posted_params);
+		p_mixer->effect_automated = false;
+	}
+
+	p_mixer->probe.arm(AudioTrigger_WavePlay);
+}
+
+void audio_mixer_wave_play(AudioContext *p_context)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	if (mixer->voice == NULL)
+	{
+		return;
+	}
+
+	audio_mixer_voice_start(mixer, NULL, 0);
+}
+
+bool audio_mixer_automation_play(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	if (mixer->voice == NULL)
+	{
+		return false;
+	}
+
+	audio_mixer_voice_start(mixer, p_events, p_count);
+	return true;
+}
+
+bool audio_mixer_wave_playing(AudioContext *p_context)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	return mixer->voice != NULL && mixer->voice->playing;
+}
+
+bool audio_mixer_set_tail_mode(AudioContext *p_context, AudioTailMode p_mode)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	mixer->tail_mode = p_mode;
+	return true;
+}
+
+void audio_mixer_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params, uint32_t p_changed)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	mixer->probe.begin(AudioTrigger_EffectChange);
+
+	mixer->effect_requested.enabled = p_enabled;
+	mixer->effect_requested.params = *p_params;
+	mixer->effect_requested.params_serial++;
+	mixer->effect_requested.morph_frames = 0;
+	mixer->effect_fields |= p_changed;
+	mixer->effect_changed = true;
+	audio_mixer_post(mixer);
+}
+
+void audio_mixer_effect_morph(AudioContext *p_context, const ReverbParameters *p_target, float p_seconds)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+	AudioMixerMessage &request = mixer->effect_requested;
+
+	mixer->probe.begin(AudioTrigger_EffectChange);
+
+	mixer->effect_fields |= audio_reverb_changed_fields(&request.params, p_target);
+	request.params = *p_target;
+	request.params_serial++;
+	request.morph_frames = (uint32_t) fmaxf(p_seconds * AUDIO_MASTER_SAMPLERATE + 0.5f, 0.0f);
+	mixer->effect_changed = true;
+	audio_mixer_post(mixer);
+}
+
+size_t audio_mixer_effect_mode_times(AudioContext *p_context, AudioEffectMode p_mode, float *p_times, size_t p_max)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	if (p_mode >= AudioEffectMode_Count)
+		return 0;
+
+	return mixer->effect_mode_times[p_mode].copy(p_times, p_max);
+}
+
+void audio_mixer_begin_changes(AudioContext *p_context)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	mixer->effect_batch = true;
+	mixer->effect_batch_changed = false;
+}
+
+void audio_mixer_commit_changes(AudioContext *p_context)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	// a new mode and new parameters in the same batch are prepared only once
+	if (mixer->effect_batch && mixer->effect_batch_changed)
+		audio_mixer_publish(mixer);
+
+	mixer->effect_batch = false;
+}
+
+size_t audio_mixer_render(AudioContext *p_context, float *p_output, size_t p_frames)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	size_t channels = mixer->output_channels;
+	size_t quantum_frames = mixer->quantum_frames;
+	size_t done = 0;
+
+	while (done < p_frames)
+	{
+		if (mixer->mix_offset >= quantum_frames)
+		{
+			audio_mixer_render_quantum(mixer);
+		}
+
+		size_t count = quantum_frames - mixer->mix_offset;
+		if (count > p_frames - done)
+			count = p_frames - done;
+
+		memcpy(p_output + done * channels, mixer->mix_buffer.data() + mixer->mix_offset * channels, sizeof(float) * count * channels);
+
+		mixer->mix_offset += count;
+		done += count;
+	}
+
+	return done;
+}
+
+double audio_mixer_trigger_latency(AudioContext *p_context, AudioTrigger p_trigger)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	return mixer->probe.latency(p_trigger);
+}
+
+size_t audio_mixer_quantum_times(AudioContext *p_context, float *p_times, size_t p_max)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	return mixer->quantum_times.copy(p_times, p_max);
+}
+
+uint32_t audio_mixer_quantum_frames(AudioContext *p_context)
+{
+	AudioMixer *mixer = (AudioMixer *) p_context;
+
+	return mixer->quantum_frames;
+}
@@ -0,0 +1,176 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_MIXER_H
+#define FAUDIOFILTERDEMO_AUDIO_MIXER_H
+
+#include "audio.h"
+
+#include "dr_wav.h"
+#include "audio_automation.h"
+#include "audio_mailbox.h"
+#include "audio_probe.h"
+#include "audio_tail.h"
+#include "audio_timing.h"
+
+#include <atomic>
+#include <vector>
+
+// caller-driven mixer of the offline and native engines: mixes on the caller's thread into caller-owned buffers, one
+//	quantum at a time when audio_render asks for more output. The voice sends to a bus that runs the reverb once per
+//	quantum, the engines only differ in the reverb they plug into the bus through an AudioMixerEffect. Their contexts
+//	derive from AudioMixer, the audio_mixer_* functions implement the PFN_AUDIO_* pointers they have in common.
+
+const uint32_t AUDIO_MIXER_TAIL_FRAMES = 2 * 48000;					// same as the silence buffer of faudio_wave_play
+
+struct AudioMixer;
+
+// state of the effect as the API last set it, posted to the mixer through a mailbox
+struct AudioMixerMessage
+{
+	uint64_t		 serial;			// counts the posts
+	bool			 enabled;
+	AudioEffectMode	 mode;
+	ReverbParameters params;
+	uint64_t		 params_serial;		// counts the changes of params, a repost with the same one leaves a morph running
+	uint32_t		 morph_frames;		// 0 to set params at once
+	void *			 effect_data;		// engine specific, e.g. the impulse response of the convolution mode
+};
+
+// the reverb of the bus. process and set_params run on the mixer thread and must not block, reset and prepare run on
+//	the API thread.
+struct AudioMixerEffect
+{
+	// processes p_frames of the bus (bus_channels) into p_output (output_channels), dry and wet mixed by WetDryMix.
+	//	p_output is overwritten.
+	void (*process)(AudioMixer *p_mixer, const float *p_bus, float *p_output, uint32_t p_frames);
+
+	// the parameters the following frames are processed with
+	void (*set_params)(AudioMixer *p_mixer, const ReverbParameters *p_params);
+
+	// clears the state for a new sample of p_channels, called by audio_wave_load. Returns the channel count of the bus
+	//	the voice sends to, 0 when the effect can't take the sample.
+	unsigned int (*reset)(AudioMixer *p_mixer, unsigned int p_channels);
+
+	// may be null: completes the request before it is posted, e.g. captures an impulse response
+	void (*prepare)(AudioMixer *p_mixer, AudioMixerMessage *p_request);
+
+	uint32_t morph_step;				// the effect gets new parameters this often while morphing
+};
+
+// the AudioVoice handles of the engines point to these
+struct AudioMixerVoice
+{
+	AudioMixer *  mixer;
+
+	float *		  buffer;
+	size_t		  buffer_size;
+	int			  sample_rate;
+	int			  num_channels;
+
+	float		  volume;
+	float		  frequency;
+	float		  send_level;		// part of the voice that goes through the reverb bus
+
+	bool		  playing;
+	double		  position;			// read position in source frames, runs into the silence tail after buffer_size
+	AudioTailDetector tail;			// quiet frames once only the tail is left
+
+	std::vector<float> source_buffer;
+};
+
+struct AudioMixer
+{
+	AudioMixerEffect effect;
+
+	bool output_5p1;
+	unsigned int output_channels;
+
+	unsigned int wav_channels;
+	unsigned int wav_samplerate;
+	drwav_uint64 wav_sample_count;
+	float *		 wav_samples;
+
+	AudioMixerVoice *voice;
+
+	// the bus every voice sends to, it runs once per quantum no matter how many voices play
+	unsigned int		   bus_channels;	// chosen by the effect for the loaded wave
+	std::vector<float>	   bus_buffer;		// the sends of all voices
+	std::vector<float>	   effect_buffer;	// output layout, written by the effect
+
+	// the effect as the mixer currently runs it, taken from the mailbox at the start of a quantum
+	ReverbParameters	   reverb_params;
+	uint64_t			   params_serial;
+	bool				   reverb_enabled;
+	AudioEffectMode		   effect_mode;
+	void *				   effect_data;
+	AudioTailMode		   tail_mode;
+
+	// audio_effect_morph, run by the mixer: reverb_params steps from morph_from to morph_to
+	ReverbParameters	   morph_from;
+	ReverbParameters	   morph_to;
+	uint32_t			   morph_frames;	// 0 while no morph runs
+	uint32_t			   morph_position;
+
+	// audio_automation_play: events of the playing voice, the quantum is split at every one of them. The effect keeps the
+	//	state of the last event until the next play, which goes back to the posted state first.
+	AudioAutomationCursor  automation;
+	bool				   posted_enabled;		// the state last taken from the mailbox
+	ReverbParameters	   posted_params;
+	bool				   effect_automated;	// an event changed the effect since
+
+	// audio_effect_change and the like only post to the mailbox, they never wait on the mixer
+	AudioMailbox<AudioMixerMessage> effect_mailbox;
+	std::atomic<uint64_t>  effect_received;		// serial of the message the mixer took last
+	AudioMixerMessage	   effect_requested;	// API side
+	uint32_t			   effect_fields;		// API side, fields changed since the effect took them in prepare
+	bool				   effect_changed;		// API side, the effect changed since its last post, which arms the probe
+	bool				   effect_batch;		// API side, between audio_begin_changes and the commit
+	bool				   effect_batch_changed;	// API side, the batch has a state to post
+
+	uint32_t			   quantum_frames;
+	std::vector<float>	   mix_buffer;		// last rendered quantum of master output
+	size_t				   mix_offset;		// first frame of mix_buffer not yet handed to the caller
+
+	AudioTriggerProbe	   probe;
+	AudioTimingHistory	   quantum_times;
+	AudioTimingHistory	   effect_mode_times[AudioEffectMode_Count];
+};
+
+// sets up the mixer of a new context, the engine creates its effect and loads the first wave afterwards
+void audio_mixer_init(AudioMixer *p_mixer, const AudioMixerEffect &p_effect, bool p_output_5p1, uint32_t p_quantum);
+
+// frees the voice and the wave, the engine deletes its context afterwards
+void audio_mixer_release(AudioMixer *p_mixer);
+
+// posts effect_requested to the mixer, or at the commit within a batch
+void audio_mixer_post(AudioMixer *p_mixer);
+
+// row-major [dst][src] matrix of a p_src_channels layout (1 or 2) into p_dst_channels, front left / front right are the
+//	first two channels of both layouts
+void audio_mixer_default_matrix(unsigned int p_src_channels, unsigned int p_dst_channels, float *p_matrix);
+
+// the buffers, the wave and the voice, without the context itself
+size_t audio_mixer_bytes_in_use(AudioMixer *p_mixer);
+
+AudioVoice *audio_mixer_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels);
+void audio_mixer_voice_destroy(AudioVoice *p_voice);
+void audio_mixer_voice_set_volume(AudioVoice *p_voice, float p_volume);
+void audio_mixer_voice_set_frequency(AudioVoice *p_voice, float p_frequency);
+void audio_mixer_voice_set_send_level(AudioVoice *p_voice, float p_level);
+
+void audio_mixer_wave_load(AudioContext *p_context, AudioSampleWave sample, bool stereo);
+void audio_mixer_wave_play(AudioContext *p_context);
+bool audio_mixer_wave_playing(AudioContext *p_context);
+bool audio_mixer_automation_play(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count);
+bool audio_mixer_set_tail_mode(AudioContext *p_context, AudioTailMode p_mode);
+
+void audio_mixer_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params, uint32_t p_changed);
+void audio_mixer_effect_morph(AudioContext *p_context, const ReverbParameters *p_target, float p_seconds);
+size_t audio_mixer_effect_mode_times(AudioContext *p_context, AudioEffectMode p_mode, float *p_times, size_t p_max);
+void audio_mixer_begin_changes(AudioContext *p_context);
+void audio_mixer_commit_changes(AudioContext *p_context);
+
+size_t audio_mixer_render(AudioContext *p_context, float *p_output, size_t p_frames);
+double audio_mixer_trigger_latency(AudioContext *p_context, AudioTrigger p_trigger);
+size_t audio_mixer_quantum_times(AudioContext *p_context, float *p_times, size_t p_max);
+uint32_t audio_mixer_quantum_frames(AudioContext *p_context);
+
+#endif // FAUDIOFILTERDEMO_AUDIO_MIXER_H
@@ -0,0 +1,363 @@
+#include "audio.h"
+
+#include "audio_mixer.h"
+#include "audio_workers.h"
+#include "native_convolution.h"
+#include "native_ir_cache.h"
+#include "native_reverb.h"
+
+#include <string.h>
+#include <vector>
+
+// native engine: the caller-driven mixer of audio_mixer.h, like the offline engine, but with the in-repo reverb of
+//	native_reverb.h instead of the FAudio XAPO, so it has no dependency on FAudio at all. audio_render pulls the output,
+//	either from a headless tool or from the audio device callback of the application.
+
+const unsigned int NATIVE_BUS_CHANNELS = 2;						// mono voices send to both sides, the reverb downmixes them again
+const unsigned int NATIVE_MAX_WORKERS = 3;						// the 5.1 responses have 4 audible channels
+const uint32_t NATIVE_MORPH_FRAMES = 64;							// the reverb gets new parameters this often while morphing
+
+// the captured impulse response of one parameter set, split into the channel groups of the worker threads. Created and
+//	destroyed by the API thread, the mixer only uses it.
+struct NativeConvolutionSet
+{
+	uint64_t						 serial;			// the post that first handed it to the mixer
+	ReverbParameters				 params;			// what the impulse response was captured with
+	std::vector<NativeConvolution *> groups;
+	std::vector<float>				 group_buffer;		// output layout per channel group, joined into the effect output
+};
+
+// the AudioContext handles of this engine point to the AudioMixer of these
+struct NativeContext : AudioMixer
+{
+	NativeReverb *		   reverb;
+
+	// convolution mode: the mixer runs the set of its effect_data, null until the mode is first used
+	float				   convolution_wet;
+	float				   convolution_dry;
+	std::vector<float>	   mono_buffer;		// input of the convolution
+	uint32_t			   group_frames;	// frames of the quantum the groups are working on
+
+	// the output channels of the convolution don't depend on each other, with a pool every group of channels gets its
+	//	own convolution and runs on its own thread. Only for 5.1, null otherwise.
+	AudioWorkerPool *	   workers;
+
+	// API side, oldest first. A set is freed once the mixer took a post that references a newer one.
+	std::vector<NativeConvolutionSet *> convolution_sets;
+};
+
+// captures the impulse response of p_params into a new convolution set
+static NativeConvolutionSet *native_convolution_set_create(NativeContext *p_context, const ReverbParameters *p_params, uint64_t p_serial)
+{
+	std::vector<float> scratch;
+	uint32_t frames;
+	unsigned int channels = p_context->output_channels;
+	const float *response = native_ir_cache_response(p_params, AUDIO_MASTER_SAMPLERATE, channels, &frames, scratch);
+
+	NativeConvolutionSet *result = new NativeConvolutionSet();
+	result->serial = p_serial;
+	result->params = *p_params;
+
+	// audible channels of the response, spread over as many groups as there are threads
+	std::vector<unsigned int> audible;
+	for (unsigned int ch = 0; ch < channels; ++ch)
+	{
+		bool silent = true;
+		for (uint32_t frame = 0; frame < frames && silent; ++frame)
+			silent = response[frame * channels + ch] == 0.0f;
+
+		if (!silent)
+			audible.push_back(ch);
+	}
+
+	size_t groups = (p_context->workers != NULL) ? p_context->workers->workers() + 1 : 1;
+	if (groups > audible.size())
+		groups = audible.size();
+
+	if (groups <= 1)
+	{
+		result->groups.push_back(native_convolution_create(response, frames, channels, p_context->quantum_frames));
+	}
+	else
+	{
+		// every group convolves a copy of the response with the channels of the other groups silenced, the convolution
+		//	skips those
+		std::vector<float> group_response(response, response + (size_t) frames * channels);
+
+		for (size_t group = 0; group < groups; ++group)
+		{
+			for (size_t idx = 0; idx < audible.size(); ++idx)
+			{
+				unsigned int ch = audible[idx];
+
+				for (uint32_t frame = 0; frame < frames; ++frame)
+					group_response[frame * channels + ch] = (idx % groups == group) ? response[frame * channels + ch] : 0.0f;
+			}
+
+			result->groups.push_back(native_convolution_create(group_response.data(), frames, channels, p_context->quantum_frames));
+		}
+	}
+
+	result->group_buffer.resize(result->groups.size() * p_context->quantum_frames * channels);
+	return result;
+}
+
+static void native_convolution_set_destroy(NativeConvolutionSet *p_set)
+{
+	for (NativeConvolution *convolution : p_set->groups)
+		native_convolution_destroy(convolution);
+
+	delete p_set;
+}
+
+// job of the worker pool, convolves the mono input of the quantum for one channel group
+static void native_bus_convolve_group(void *p_data, unsigned int p_group)
+{
+	NativeContext *context = (NativeContext *) p_data;
+	NativeConvolutionSet *set = (NativeConvolutionSet *) context->effect_data;
+	float *output = set->group_buffer.data() + (size_t) p_group * context->quantum_frames * context->output_channels;
+
+	native_convolution_process(set->groups[p_group], context->mono_buffer.data(), output, context->group_frames);
+}
+
+static void native_bus_convolve(NativeContext *p_context, NativeConvolutionSet *p_set, const float *p_source, float *p_output, uint32_t p_frames)
+{
+	unsigned int src_channels = NATIVE_BUS_CHANNELS;
+	unsigned int dst_channels = p_context->output_channels;
+	float *mono = p_context->mono_buffer.data();
+	float scale = 1.0f / src_channels;
+
+	// same downmix as the algorithmic reverb
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		float sum = 0.0f;
+		for (unsigned int ch = 0; ch < src_channels; ++ch)
+			sum += p_source[frame * src_channels + ch];
+		mono[frame] = sum * scale;
+	}
+
+	if (p_set->groups.size() == 1)
+	{
+		native_convolution_process(p_set->groups[0], mono, p_output, p_frames);
+	}
+	else
+	{
+		unsigned int groups = (unsigned int) p_set->groups.size();
+
+		p_context->group_frames = p_frames;
+		p_context->workers->run(native_bus_convolve_group, p_context, groups);
+
+		// join, every channel is written by one group and zero in the others
+		size_t group_size = (size_t) p_context->quantum_frames * dst_channels;
+		memcpy(p_output, p_set->group_buffer.data(), sizeof(float) * p_frames * dst_channels);
+
+		for (unsigned int group = 1; group < groups; ++group)
+		{
+			const float *part = p_set->group_buffer.data() + group * group_size;
+
+			for (uint32_t idx = 0; idx < p_frames * dst_channels; ++idx)
+				p_output[idx] += part[idx];
+		}
+	}
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		const float *in = p_source + frame * src_channels;
+		float *out = p_output + frame * dst_channels;
+
+		for (unsigned int ch = 0; ch < dst_channels; ++ch)
+			out[ch] *= p_context->convolution_wet;
+
+		out[0] += p_context->convolution_dry * in[0];
+		out[1] += p_context->convolution_dry * in[src_channels - 1];
+	}
+}
+
+// AudioMixerEffect: the reverb writes the output layout directly
+static void native_effect_process(AudioMixer *p_mixer, const float *p_bus, float *p_output, uint32_t p_frames)
+{
+	NativeContext *context = (NativeContext *) p_mixer;
+	NativeConvolutionSet *set = (NativeConvolutionSet *) context->effect_data;
+
+	if (context->effect_mode == AudioEffectMode_Convolution && set != NULL)
+		native_bus_convolve(context, set, p_bus, p_output, p_frames);
+	else
+		native_reverb_process(context->reverb, p_bus, p_output, p_frames);
+}
+
+static void native_effect_set_params(AudioMixer *p_mixer, const ReverbParameters *p_params)
+{
+	NativeContext *context = (NativeContext *) p_mixer;
+
+	native_reverb_set_params(context->reverb, p_params);
+
+	// the response is captured at full wet level, the convolution mixes it by WetDryMix itself. It uses the response of a
+	//	morph target right away, and its mix along with it.
+	const ReverbParameters *mix_params = (context->morph_frames > 0) ? &context->morph_to : p_params;
+
+	NativeReverbCoefficients coefs;
+	native_reverb_compute_coefficients(mix_params, AUDIO_MASTER_SAMPLERATE, &coefs, AudioReverbField_WetDryMix);
+	context->convolution_wet = coefs.wet;
+	context->convolution_dry = coefs.dry;
+}
+
+static unsigned int native_effect_reset(AudioMixer *p_mixer, unsigned int p_channels)
+{
+	NativeContext *context = (NativeContext *) p_mixer;
+	NativeConvolutionSet *set = (NativeConvolutionSet *) context->effect_data;
+
+	native_reverb_reset(context->reverb);
+
+	if (set)
+	{
+		for (NativeConvolution *convolution : set->groups)
+			native_convolution_reset(convolution);
+	}
+
+	return NATIVE_BUS_CHANNELS;
+}
+
+// the impulse response is (re)captured here, on the API thread, when the convolution mode is used and the parameters
+//	changed
+static void native_effect_prepare(AudioMixer *p_mixer, AudioMixerMessage *p_request)
+{
+	NativeContext *context = (NativeContext *) p_mixer;
+	std::vector<NativeConvolutionSet *> &sets = context->convolution_sets;
+
+	// the mixer never goes back to a set older than the one of the last post it took
+	uint64_t received = context->effect_received.load(std::memory_order_acquire);
+
+	while (sets.size() > 1 && sets[1]->serial <= received)
+	{
+		native_convolution_set_destroy(sets.front());
+		sets.erase(sets.begin());
+	}
+
+	if (p_request->mode == AudioEffectMode_Convolution && p_request->enabled)
+	{
+		ReverbParameters params = p_request->params;
+		params.WetDryMix = 100.0f;
+
+		if (sets.empty() || ((context->effect_fields & ~AudioReverbField_WetDryMix) && memcmp(&params, &sets.back()->params, sizeof(ReverbParameters)) != 0))
+			sets.push_back(native_convolution_set_create(context, &params, p_request->serial));
+
+		context->effect_fields = 0;
+	}
+
+	p_request->effect_data = sets.empty() ? NULL : sets.back();
+}
+
+void native_destroy_context(AudioContext *p_context)
+{
+	NativeContext *context = (NativeContext *) (AudioMixer *) p_context;
+
+	audio_mixer_release(context);
+	native_reverb_destroy(context->reverb);
+
+	for (NativeConvolutionSet *set : context->convolution_sets)
+		native_convolution_set_destroy(set);
+
+	delete context->workers;
+	delete context;
+}
+
+// the convolution would need the impulse response of every event, which can't be captured on the mixer thread
+bool native_automation_play(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count)
+{
+	NativeContext *context = (NativeContext *) (AudioMixer *) p_context;
+
+	if (context->effect_requested.mode == AudioEffectMode_Convolution)
+		return false;
+
+	return audio_mixer_automation_play(p_context, p_events, p_count);
+}
+
+bool native_effect_set_mode(AudioContext *p_context, AudioEffectMode p_mode)
+{
+	NativeContext *context = (NativeContext *) (AudioMixer *) p_context;
+
+	if (p_mode >= AudioEffectMode_Count)
+		return false;
+
+	context->effect_requested.mode = p_mode;
+	audio_mixer_post(context);
+	return true;
+}
+
+size_t native_bytes_in_use(AudioContext *p_context)
+{
+	NativeContext *context = (NativeContext *) (AudioMixer *) p_context;
+
+	size_t result = sizeof(NativeContext) + audio_mixer_bytes_in_use(context);
+
+	result += native_reverb_bytes_in_use(context->reverb);
+	result += context->mono_buffer.capacity() * sizeof(float);
+
+	for (NativeConvolutionSet *set : context->convolution_sets)
+	{
+		result += sizeof(NativeConvolutionSet) + set->group_buffer.capacity() * sizeof(float);
+
+		for (NativeConvolution *convolution : set->groups)
+			result += native_convolution_bytes_in_use(convolution);
+	}
+
+	return result;
+}
+
+AudioContext *native_create_context(bool output_5p1, uint32_t p_quantum, unsigned int p_workers)
+{
+	// setup function pointers
+	audio_destroy_context = native_destroy_context;
+	audio_create_voice = audio_mixer_create_voice;
+	audio_voice_destroy = audio_mixer_voice_destroy;
+	audio_voice_set_volume = audio_mixer_voice_set_volume;
+	audio_voice_set_frequency = audio_mixer_voice_set_frequency;
+	audio_voice_set_send_level = audio_mixer_voice_set_send_level;
+
+	audio_wave_load = audio_mixer_wave_load;
+	audio_wave_play = audio_mixer_wave_play;
+	audio_wave_playing = audio_mixer_wave_playing;
+	audio_automation_play = native_automation_play;
+	audio_set_tail_mode = audio_mixer_set_tail_mode;
+
+	audio_effect_change = audio_mixer_effect_change;
+	audio_effect_morph = audio_mixer_effect_morph;
+	audio_effect_set_mode = native_effect_set_mode;
+	audio_effect_mode_times = audio_mixer_effect_mode_times;
+	audio_begin_changes = audio_mixer_begin_changes;
+	audio_commit_changes = audio_mixer_commit_changes;
+
+	audio_render = audio_mixer_render;
+	audio_trigger_latency = audio_mixer_trigger_latency;
+	audio_bytes_in_use = native_bytes_in_use;
+	audio_quantum_times = audio_mixer_quantum_times;
+	audio_quantum_frames = audio_mixer_quantum_frames;
+
+	// return a context object
+	AudioMixerEffect effect;
+	effect.process = native_effect_process;
+	effect.set_params = native_effect_set_params;
+	effect.reset = native_effect_reset;
+	effect.prepare = native_effect_prepare;
+	effect.morph_step = NATIVE_MORPH_FRAMES;
+
+	NativeContext *context = new NativeContext();
+	audio_mixer_init(context, effect, output_5p1, p_quantum);
+
+	// create the reverb of the bus
+	context->reverb = native_reverb_create(AUDIO_MASTER_SAMPLERATE, NATIVE_BUS_CHANNELS, context->output_channels, context->quantum_frames);
+	native_effect_set_params(context, &context->reverb_params);
+	context->mono_buffer.resize(context->quantum_frames);
+	context->group_frames = 0;
+
+	if (p_workers > NATIVE_MAX_WORKERS)
+		p_workers = NATIVE_MAX_WORKERS;
+
+	context->workers = (output_5p1 && p_workers > 0) ? new AudioWorkerPool(p_workers) : NULL;
+
+	// load the first wave
+	AudioContext *result = (AudioContext *) (AudioMixer *) context;
+	audio_wave_load(result, (AudioSampleWave) 0, false);
+
+	return result;
+}
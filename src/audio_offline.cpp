@@ -0,0 +1,189 @@
+#include "audio.h"
+
+#include <FAudio.h>
+#include <FAudioFX.h>
+#include <FAPO.h>
+
+#include "audio_mixer.h"
+
+#include <string.h>
+#include <vector>
+
+// offline engine: the caller-driven mixer of audio_mixer.h with the FAudio reverb XAPO on its bus. There is no device
+//	and no real-time pacing, so the output is fully deterministic.
+
+// the AudioContext handles of this engine point to the AudioMixer of these
+struct OfflineContext : AudioMixer
+{
+	// the reverb of the bus, locked for the channel count of the loaded wave
+	FAPO *				   reverb;
+	unsigned int		   reverb_channels;		// 0 while it isn't locked
+	std::vector<float>	   reverb_buffer;		// output of the reverb, in the layout of the bus
+};
+
+// AudioMixerEffect: the XAPO keeps the channel count of the bus, its output is spread over the output layout here
+static void offline_effect_process(AudioMixer *p_mixer, const float *p_bus, float *p_output, uint32_t p_frames)
+{
+	OfflineContext *context = (OfflineContext *) p_mixer;
+	unsigned int bus_channels = context->reverb_channels;
+
+	FAPOProcessBufferParameters in_params;
+	in_params.pBuffer = (float *) p_bus;
+	in_params.BufferFlags = FAPO_BUFFER_VALID;
+	in_params.ValidFrameCount = p_frames;
+
+	FAPOProcessBufferParameters out_params;
+	out_params.pBuffer = context->reverb_buffer.data();
+	out_params.BufferFlags = FAPO_BUFFER_VALID;
+	out_params.ValidFrameCount = p_frames;
+
+	context->reverb->Process(context->reverb, 1, &in_params, 1, &out_params, 1);
+
+	float matrix[6 * 2];
+	audio_mixer_default_matrix(bus_channels, context->output_channels, matrix);
+
+	const float *effect = context->reverb_buffer.data();
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		for (unsigned int dst = 0; dst < context->output_channels; ++dst)
+		{
+			float sum = 0.0f;
+
+			for (unsigned int src = 0; src < bus_channels; ++src)
+			{
+				sum += matrix[dst * bus_channels + src] * effect[frame * bus_channels + src];
+			}
+
+			p_output[frame * context->output_channels + dst] = sum;
+		}
+	}
+}
+
+static void offline_effect_set_params(AudioMixer *p_mixer, const ReverbParameters *p_params)
+{
+	OfflineContext *context = (OfflineContext *) p_mixer;
+
+	context->reverb->SetParameters(context->reverb, p_params, sizeof(ReverbParameters));
+}
+
+// (re)locks the reverb for p_channels, which also clears its state. The bus takes the channel count of the wave.
+static unsigned int offline_effect_reset(AudioMixer *p_mixer, unsigned int p_channels)
+{
+	OfflineContext *context = (OfflineContext *) p_mixer;
+
+	if (context->reverb_channels != 0)
+	{
+		context->reverb->UnlockForProcess(context->reverb);
+		context->reverb_channels = 0;
+	}
+
+	// the same channel count on both sides like faudio_create_voice
+	FAudioWaveFormatEx waveFormat;
+	waveFormat.wFormatTag = 3;
+	waveFormat.nChannels = p_channels;
+	waveFormat.nSamplesPerSec = AUDIO_MASTER_SAMPLERATE;
+	waveFormat.nAvgBytesPerSec = AUDIO_MASTER_SAMPLERATE * p_channels * 4;
+	waveFormat.nBlockAlign = p_channels * 4;
+	waveFormat.wBitsPerSample = 32;
+	waveFormat.cbSize = 0;
+
+	FAPOLockForProcessBufferParameters lock_params;
+	lock_params.pFormat = &waveFormat;
+	lock_params.MaxFrameCount = context->quantum_frames;
+
+	if (context->reverb->LockForProcess(context->reverb, 1, &lock_params, 1, &lock_params) != 0)
+		return 0;
+
+	context->reverb_channels = p_channels;
+	context->reverb_buffer.resize(context->quantum_frames * p_channels);
+
+	context->reverb->SetParameters(context->reverb, &context->reverb_params, sizeof(context->reverb_params));
+	return p_channels;
+}
+
+void offline_destroy_context(AudioContext *p_context)
+{
+	OfflineContext *context = (OfflineContext *) (AudioMixer *) p_context;
+
+	audio_mixer_release(context);
+
+	if (context->reverb_channels != 0)
+	{
+		context->reverb->UnlockForProcess(context->reverb);
+	}
+
+	context->reverb->Release(context->reverb);
+	delete context;
+}
+
+bool offline_effect_set_mode(AudioContext *p_context, AudioEffectMode p_mode)
+{
+	return p_mode == AudioEffectMode_Algorithmic;
+}
+
+size_t offline_bytes_in_use(AudioContext *p_context)
+{
+	OfflineContext *context = (OfflineContext *) (AudioMixer *) p_context;
+
+	return sizeof(OfflineContext) + audio_mixer_bytes_in_use(context) + context->reverb_buffer.capacity() * sizeof(float);
+}
+
+AudioContext *offline_create_context(bool output_5p1, uint32_t p_quantum)
+{
+	// setup function pointers
+	audio_destroy_context = offline_destroy_context;
+	audio_create_voice = audio_mixer_create_voice;
+	audio_voice_destroy = audio_mixer_voice_destroy;
+	audio_voice_set_volume = audio_mixer_voice_set_volume;
+	audio_voice_set_frequency = audio_mixer_voice_set_frequency;
+	audio_voice_set_send_level = audio_mixer_voice_set_send_level;
+
+	audio_wave_load = audio_mixer_wave_load;
+	audio_wave_play = audio_mixer_wave_play;
+	audio_wave_playing = audio_mixer_wave_playing;
+	audio_automation_play = audio_mixer_automation_play;
+	audio_set_tail_mode = audio_mixer_set_tail_mode;
+
+	audio_effect_change = audio_mixer_effect_change;
+	audio_effect_morph = audio_mixer_effect_morph;
+	audio_effect_set_mode = offline_effect_set_mode;
+	audio_effect_mode_times = audio_mixer_effect_mode_times;
+	audio_begin_changes = audio_mixer_begin_changes;
+	audio_commit_changes = audio_mixer_commit_changes;
+
+	audio_render = audio_mixer_render;
+	audio_trigger_latency = audio_mixer_trigger_latency;
+	audio_bytes_in_use = offline_bytes_in_use;
+	audio_quantum_times = audio_mixer_quantum_times;
+	audio_quantum_frames = audio_mixer_quantum_frames;
+
+	// create the reverb of the bus, wave_load locks it for the channel count of the wave
+	void *xapo = nullptr;
+	uint32_t hr = FAudioCreateReverb(&xapo, 0);
+
+	if (hr != 0)
+	{
+		return nullptr;
+	}
+
+	// return a context object, the parameters step once per quantum while morphing
+	AudioMixerEffect effect;
+	effect.process = offline_effect_process;
+	effect.set_params = offline_effect_set_params;
+	effect.reset = offline_effect_reset;
+	effect.prepare = NULL;
+	effect.morph_step = p_quantum;
+
+	OfflineContext *context = new OfflineContext();
+	audio_mixer_init(context, effect, output_5p1, p_quantum);
+
+	context->reverb = (FAPO *) xapo;
+	context->reverb_channels = 0;
+
+	// load the first wave
+	AudioContext *result = (AudioContext *) (AudioMixer *) context;
+	audio_wave_load(result, (AudioSampleWave) 0, false);
+
+	return result;
+}
@@ -2,18 +2,21 @@
 #define FAUDIOFILTERDEMO_AUDIO_PLAYER_H
 
 #include "audio.h"
+#include "audio_automation.h"
+#include "audio_timing.h"
 
 class AudioPlayer
 {
 	public :
-		AudioPlayer() 
+		AudioPlayer() : m_effect_sent(0), m_effect_suppressed(0), m_automation_slot(0)
 		{
 			setup(AudioEngine_FAudio, false);
 		}
 
-		void setup(AudioEngine p_engine, bool output_5p1)
+		void setup(AudioEngine p_engine, bool output_5p1, uint32_t p_quantum = AUDIO_DEFAULT_QUANTUM)
 		{
-			m_context = audio_create_context(p_engine, output_5p1);
+			m_context = audio_create_context(p_engine, output_5p1, p_quantum);
+			m_effect_valid = false;		// a new context gets the whole effect state
 		}
 
 		void shutdown()
@@ -41,16 +44,164 @@ class AudioPlayer
 			audio_wave_play(m_context);
 		}
 
+		// replays a recording against the voice, false when the engine can't. The mixer reads the events of the previous
+		//	replay until the voice restarted, so the copy goes to the other slot and p_automation may change right away.
+		bool play_automation(const AudioAutomation &p_automation)
+		{
+			if (m_context == nullptr || p_automation.count() == 0)
+				return false;
+
+			m_automation_slot ^= 1;
+			m_automation[m_automation_slot] = p_automation;
+
+			// the events change the effect behind the back of change_effect, the next change has to send everything
+			m_effect_valid = false;
+
+			const AudioAutomation &automation = m_automation[m_automation_slot];
+			return audio_automation_play(m_context, automation.events(), automation.count());
+		}
+
+		bool set_tail_mode(AudioTailMode p_mode)
+		{
+			if (m_context == nullptr)
+				return false;
+
+			return audio_set_tail_mode(m_context, p_mode);
+		}
+
+		// the GUI rebuilds the parameters every frame, only the ones that differ from the last change reach the engine
 		void change_effect(bool p_enabled, ReverbParameters *p_params)
 		{
 			if (m_context == nullptr)
 				return;
 
-			audio_effect_change(m_context, p_enabled, p_params);
+			uint32_t changed = m_effect_valid ? audio_reverb_changed_fields(&m_effect_params, p_params) : AudioReverbField_All;
+
+			if (m_effect_valid && changed == 0 && p_enabled == m_effect_enabled)
+			{
+				++m_effect_suppressed;
+				return;
+			}
+
+			m_effect_times.start();
+			audio_effect_change(m_context, p_enabled, p_params, changed);
+			m_effect_times.stop();
+
+			m_effect_enabled = p_enabled;
+			m_effect_params = *p_params;
+			m_effect_valid = true;
+			++m_effect_sent;
+		}
+
+		// crossfades to p_target on the audio thread, the GUI doesn't have to send the steps in between
+		void morph_effect(const ReverbParameters *p_target, float p_seconds)
+		{
+			if (m_context == nullptr)
+				return;
+
+			m_effect_times.start();
+			audio_effect_morph(m_context, p_target, p_seconds);
+			m_effect_times.stop();
+
+			// later changes are diffed against where the morph ends
+			m_effect_params = *p_target;
+			++m_effect_sent;
+		}
+
+		// effect updates that reached the engine / calls of change_effect dropped because nothing changed
+		uint64_t effect_updates_sent() const
+		{
+			return m_effect_sent;
+		}
+
+		uint64_t effect_updates_suppressed() const
+		{
+			return m_effect_suppressed;
+		}
+
+		bool set_effect_mode(AudioEffectMode p_mode)
+		{
+			if (m_context == nullptr)
+				return false;
+
+			return audio_effect_set_mode(m_context, p_mode);
+		}
+
+		void begin_changes()
+		{
+			if (m_context == nullptr)
+				return;
+
+			audio_begin_changes(m_context);
+		}
+
+		void commit_changes()
+		{
+			if (m_context == nullptr)
+				return;
+
+			audio_commit_changes(m_context);
+		}
+
+		size_t render(float *p_output, size_t p_frames)
+		{
+			if (m_context == nullptr)
+				return 0;
+
+			return audio_render(m_context, p_output, p_frames);
+		}
+
+		size_t bytes_in_use()
+		{
+			if (m_context == nullptr)
+				return 0;
+
+			return audio_bytes_in_use(m_context);
+		}
+
+		size_t effect_times(float *p_times, size_t p_max) const
+		{
+			return m_effect_times.copy(p_times, p_max);
+		}
+
+		size_t quantum_times(float *p_times, size_t p_max)
+		{
+			if (m_context == nullptr)
+				return 0;
+
+			return audio_quantum_times(m_context, p_times, p_max);
+		}
+
+		uint32_t quantum_frames()
+		{
+			if (m_context == nullptr)
+				return 0;
+
+			return audio_quantum_frames(m_context);
+		}
+
+		size_t effect_mode_times(AudioEffectMode p_mode, float *p_times, size_t p_max)
+		{
+			if (m_context == nullptr)
+				return 0;
+
+			return audio_effect_mode_times(m_context, p_mode, p_times, p_max);
 		}
 
 	private : 
-		AudioContext *	m_context;
+		AudioContext *		m_context;
+		AudioTimingHistory	m_effect_times;		// duration of change_effect in microseconds
+
+		// the effect as it was last sent to the context
+		bool				m_effect_valid;
+		bool				m_effect_enabled;
+		ReverbParameters	m_effect_params;
+		uint64_t			m_effect_sent;
+		uint64_t			m_effect_suppressed;
+
+		// the recordings handed to audio_automation_play, the latest one and the one before it
+		AudioAutomation		m_automation[2];
+		unsigned int		m_automation_slot;
 };
 
 #endif // FAUDIOFILTERDEMO_AUDIO_PLAYER_H
\ No newline at end of file
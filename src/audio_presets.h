@@ -0,0 +1,97 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_PRESETS_H
+#define FAUDIOFILTERDEMO_AUDIO_PRESETS_H
+
+#include "audio.h"
+
+// compile-time conversion of I3DL2 reverb presets to native ReverbParameters. This follows ReverbConvertI3DL2ToNative
+//	from xaudio2fx.h / FAudioFX, so a preset bank can be converted while compiling and live in read-only data:
+//
+//		static constexpr ReverbI3DL2Parameters my_presets_i3dl2[] = { ... };
+//		static constexpr AudioReverbPresetTable<3> my_presets = audio_reverb_convert_table(my_presets_i3dl2);
+//
+//	C++11 constexpr functions are restricted to a single return statement, hence the recursive helpers.
+
+// 10^(n/4) for n = 1..8: the steps of the EQ gain derived from DecayHFRatio
+constexpr double audio_reverb_quarter_decades[] =
+{
+	1.7782794100389228, 3.1622776601683795, 5.6234132519034912, 10.0,
+	17.782794100389228, 31.622776601683795, 56.234132519034912, 100.0
+};
+
+// floor(4 * |log10(p_ratio)|), limited to 8
+constexpr int audio_reverb_quarter_decade_count(double p_ratio, int p_idx = 0)
+{
+	return (p_idx < 8 && ((p_ratio >= 1.0) ? p_ratio >= audio_reverb_quarter_decades[p_idx]
+										   : p_ratio * audio_reverb_quarter_decades[p_idx] <= 1.0))
+		? 1 + audio_reverb_quarter_decade_count(p_ratio, p_idx + 1)
+		: 0;
+}
+
+constexpr uint32_t audio_reverb_reflections_delay(float p_delay_ms)
+{
+	return (p_delay_ms >= 300.0f) ? 299 : (p_delay_ms <= 1.0f) ? 1 : (uint32_t) p_delay_ms;
+}
+
+constexpr uint8_t audio_reverb_reverb_delay(float p_delay_ms)
+{
+	return (p_delay_ms >= 85.0f) ? 84 : (uint8_t) p_delay_ms;
+}
+
+constexpr ReverbParameters audio_reverb_convert_i3dl2(const ReverbI3DL2Parameters &p_i3dl2)
+{
+	return ReverbParameters {
+		p_i3dl2.WetDryMix,
+		audio_reverb_reflections_delay(p_i3dl2.ReflectionsDelay * 1000.0f),
+		audio_reverb_reverb_delay(p_i3dl2.ReverbDelay * 1000.0f),
+		5,																		// RearDelay
+		6,																		// PositionLeft
+		6,																		// PositionRight
+		27,																		// PositionMatrixLeft
+		27,																		// PositionMatrixRight
+		(uint8_t) (15.0f * p_i3dl2.Diffusion / 100.0f),							// EarlyDiffusion
+		(uint8_t) (15.0f * p_i3dl2.Diffusion / 100.0f),							// LateDiffusion
+		(uint8_t) ((p_i3dl2.DecayHFRatio >= 1.0f) ? 8 - audio_reverb_quarter_decade_count(p_i3dl2.DecayHFRatio) : 8),
+		4,																		// LowEQCutoff
+		(uint8_t) ((p_i3dl2.DecayHFRatio >= 1.0f) ? 8 : 8 - audio_reverb_quarter_decade_count(p_i3dl2.DecayHFRatio)),
+		6,																		// HighEQCutoff
+		p_i3dl2.HFReference,													// RoomFilterFreq
+		(float) p_i3dl2.Room / 100.0f,											// RoomFilterMain
+		(float) p_i3dl2.RoomHF / 100.0f,										// RoomFilterHF
+		p_i3dl2.Reflections / 100.0f,											// ReflectionsGain
+		p_i3dl2.Reverb / 100.0f,												// ReverbGain
+		(p_i3dl2.DecayHFRatio >= 1.0f) ? p_i3dl2.DecayTime * p_i3dl2.DecayHFRatio : p_i3dl2.DecayTime,
+		p_i3dl2.Density,
+		100.0f																	// RoomSize
+	};
+}
+
+// a converted preset bank. Wrapped in a struct because a constexpr function cannot return a plain array.
+template <size_t N>
+struct AudioReverbPresetTable
+{
+	ReverbParameters presets[N];
+};
+
+// C++11 has no std::index_sequence yet
+template <size_t... I>
+struct AudioIndexSequence {};
+
+template <size_t N, size_t... I>
+struct AudioMakeIndexSequence : AudioMakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct AudioMakeIndexSequence<0, I...> : AudioIndexSequence<I...> {};
+
+template <size_t N, size_t... I>
+constexpr AudioReverbPresetTable<N> audio_reverb_convert_table(const ReverbI3DL2Parameters (&p_i3dl2)[N], AudioIndexSequence<I...>)
+{
+	return AudioReverbPresetTable<N> {{ audio_reverb_convert_i3dl2(p_i3dl2[I])... }};
+}
+
+template <size_t N>
+constexpr AudioReverbPresetTable<N> audio_reverb_convert_table(const ReverbI3DL2Parameters (&p_i3dl2)[N])
+{
+	return audio_reverb_convert_table(p_i3dl2, AudioMakeIndexSequence<N>());
+}
+
+#endif // FAUDIOFILTERDEMO_AUDIO_PRESETS_H
@@ -0,0 +1,109 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_PROBE_H
+#define FAUDIOFILTERDEMO_AUDIO_PROBE_H
+
+#include "audio.h"
+
+#include <atomic>
+#include <chrono>
+
+// measures the time between an API call and the first mixing pass that reflects it. The API side calls begin() on entry
+//	and arm() once the engine calls returned, the mixer calls pass_start() / pass_end() around every quantum. Only passes
+//	that started after arm() are considered, so a pass that was already running during the call never counts.
+//	An engine whose mixer applies a posted call between two passes arms with the serial of the post instead and reports
+//	the serials it applied, only passes that started after the apply count then.
+
+class AudioTriggerProbe
+{
+	public :
+		AudioTriggerProbe() : m_pass(0)
+		{
+			for (int idx = 0; idx < AudioTrigger_Count; ++idx)
+			{
+				m_pending[idx] = false;
+				m_trigger_pass[idx] = 0;
+				m_wait_serial[idx] = 0;
+				m_trigger_time[idx] = 0;
+				m_latency[idx] = -1.0;
+			}
+		}
+
+		void begin(AudioTrigger p_trigger)
+		{
+			m_pending[p_trigger] = false;
+			m_latency[p_trigger] = -1.0;
+			m_trigger_time[p_trigger] = now();
+		}
+
+		void arm(AudioTrigger p_trigger)
+		{
+			m_wait_serial[p_trigger] = 0;
+			m_trigger_pass[p_trigger] = m_pass.load();
+			m_pending[p_trigger].store(true, std::memory_order_release);
+		}
+
+		// API side, before the post of p_serial is published: no pass counts until the mixer applied it
+		void arm_posted(AudioTrigger p_trigger, uint64_t p_serial)
+		{
+			m_wait_serial[p_trigger] = p_serial;
+			m_trigger_pass[p_trigger] = UINT64_MAX;
+			m_pending[p_trigger].store(true, std::memory_order_release);
+		}
+
+		// mixer side, between two passes: the posts up to p_serial are applied, the next pass reflects them
+		void applied(uint64_t p_serial)
+		{
+			for (int idx = 0; idx < AudioTrigger_Count; ++idx)
+			{
+				uint64_t serial = m_wait_serial[idx].load();
+
+				if (!m_pending[idx].load(std::memory_order_acquire) || serial == 0 || serial > p_serial)
+					continue;
+
+				m_trigger_pass[idx] = m_pass.load();
+				m_wait_serial[idx] = 0;
+			}
+		}
+
+		void pass_start()
+		{
+			++m_pass;
+		}
+
+		void pass_end(bool p_audible)
+		{
+			uint64_t pass = m_pass.load();
+
+			for (int idx = 0; idx < AudioTrigger_Count; ++idx)
+			{
+				if (!m_pending[idx].load(std::memory_order_acquire) || pass <= m_trigger_pass[idx])
+					continue;
+
+				if (idx == AudioTrigger_WavePlay && !p_audible)
+					continue;
+
+				m_latency[idx] = (now() - m_trigger_time[idx]) / 1000.0;
+				m_pending[idx] = false;
+			}
+		}
+
+		double latency(AudioTrigger p_trigger) const
+		{
+			return m_latency[p_trigger];
+		}
+
+	private :
+		static int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+	private :
+		std::atomic<uint64_t>	m_pass;
+		std::atomic<bool>		m_pending[AudioTrigger_Count];
+		std::atomic<uint64_t>	m_trigger_pass[AudioTrigger_Count];
+		std::atomic<uint64_t>	m_wait_serial[AudioTrigger_Count];	// 0 unless armed by arm_posted and not applied yet
+		std::atomic<int64_t>	m_trigger_time[AudioTrigger_Count];
+		std::atomic<double>		m_latency[AudioTrigger_Count];
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_PROBE_H
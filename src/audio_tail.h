@@ -0,0 +1,75 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_TAIL_H
+#define FAUDIOFILTERDEMO_AUDIO_TAIL_H
+
+#include "audio.h"
+
+#include <math.h>
+
+// tail-aware playback: instead of running every voice for a fixed 2 seconds after its sample, the tail is sized from the
+//	reverb parameters and the voice stops as soon as its output stayed below AUDIO_TAIL_THRESHOLD for a while. The
+//	engines keep the size as the upper bound and use AudioTailDetector to stop early.
+
+const float AUDIO_TAIL_THRESHOLD = 3.1623e-5f;		// -90 dBFS
+const float AUDIO_TAIL_MAX_SECONDS = 30.0f;
+
+// seconds the reverb needs after the end of the sample to fall by 90 dB (one and a half times the 60 dB DecayTime) after
+//	its pre-delays. 0 when the effect is disabled, the voice can stop with its sample then.
+inline float audio_tail_seconds(bool p_enabled, const ReverbParameters *p_params)
+{
+	if (!p_enabled)
+		return 0.0f;
+
+	float delays = (p_params->ReflectionsDelay + p_params->ReverbDelay + p_params->RearDelay) / 1000.0f;
+	float seconds = delays + 1.5f * p_params->DecayTime + 0.1f;
+
+	return fminf(seconds, AUDIO_TAIL_MAX_SECONDS);
+}
+
+// output frames the voice has to stay below the threshold before it counts as decayed: the pre-delays plus 50 ms, so a
+//	quiet gap before the delayed reflections arrive never stops it
+inline uint32_t audio_tail_hold_frames(const ReverbParameters *p_params)
+{
+	uint32_t delays = p_params->ReflectionsDelay + p_params->ReverbDelay + p_params->RearDelay;
+
+	return (delays + 50) * AUDIO_MASTER_SAMPLERATE / 1000;
+}
+
+inline float audio_tail_peak(const float *p_samples, size_t p_count)
+{
+	float result = 0.0f;
+
+	for (size_t idx = 0; idx < p_count; ++idx)
+	{
+		result = fmaxf(result, fabsf(p_samples[idx]));
+	}
+
+	return result;
+}
+
+// counts the frames the output of a voice stayed quiet. The mixer reports the peak level of every pass once only the
+//	tail is left, reset() when the voice restarts.
+
+class AudioTailDetector
+{
+	public :
+		AudioTailDetector() : m_quiet_frames(0)
+		{
+		}
+
+		void reset()
+		{
+			m_quiet_frames = 0;
+		}
+
+		// returns true once the last p_hold_frames frames were all below the threshold
+		bool decayed(float p_peak, uint32_t p_frames, uint32_t p_hold_frames)
+		{
+			m_quiet_frames = (p_peak < AUDIO_TAIL_THRESHOLD) ? m_quiet_frames + p_frames : 0;
+			return m_quiet_frames >= p_hold_frames;
+		}
+
+	private :
+		uint32_t m_quiet_frames;
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_TAIL_H
@@ -0,0 +1,70 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_TIMING_H
+#define FAUDIOFILTERDEMO_AUDIO_TIMING_H
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t AUDIO_TIMING_HISTORY = 256;
+
+// rolling history of the last AUDIO_TIMING_HISTORY durations in microseconds. One thread records with start() / stop()
+//	(or push()), any other thread can take a snapshot with copy() without locking. A snapshot taken while the writer
+//	wraps around may mix in a newer value, which is fine for display purposes.
+
+class AudioTimingHistory
+{
+	public :
+		AudioTimingHistory() : m_count(0), m_start(0)
+		{
+			for (size_t idx = 0; idx < AUDIO_TIMING_HISTORY; ++idx)
+			{
+				m_values[idx] = 0.0f;
+			}
+		}
+
+		void start()
+		{
+			m_start = now();
+		}
+
+		void stop()
+		{
+			push((now() - m_start) / 1000.0f);
+		}
+
+		void push(float p_value)
+		{
+			uint64_t count = m_count.load(std::memory_order_relaxed);
+			m_values[count % AUDIO_TIMING_HISTORY].store(p_value, std::memory_order_relaxed);
+			m_count.store(count + 1, std::memory_order_release);
+		}
+
+		// copies the most recent values, oldest first. Returns the number of values copied.
+		size_t copy(float *p_values, size_t p_max) const
+		{
+			uint64_t count = m_count.load(std::memory_order_acquire);
+			size_t available = (count < AUDIO_TIMING_HISTORY) ? (size_t) count : AUDIO_TIMING_HISTORY;
+			size_t result = (available < p_max) ? available : p_max;
+
+			for (size_t idx = 0; idx < result; ++idx)
+			{
+				p_values[idx] = m_values[(count - result + idx) % AUDIO_TIMING_HISTORY].load(std::memory_order_relaxed);
+			}
+
+			return result;
+		}
+
+	private :
+		static int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+	private :
+		std::atomic<uint64_t>	m_count;
+		std::atomic<float>		m_values[AUDIO_TIMING_HISTORY];
+		int64_t					m_start;
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_TIMING_H
@@ -0,0 +1,141 @@
+#ifndef FAUDIOFILTERDEMO_AUDIO_WORKERS_H
+#define FAUDIOFILTERDEMO_AUDIO_WORKERS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fork / join of the independent parts of one quantum. The mixer thread calls run(), which hands part 1 - n to the
+//	workers, runs part 0 itself and returns once all parts are done. The handoff has to be much shorter than a quantum,
+//	so a worker spins for a while for the next run before it goes to sleep; the mixer only pays for a wake-up when the
+//	previous run was longer ago than that.
+//
+//	Every worker acknowledges every run, also the ones with fewer parts than workers, so run() only returns once no worker
+//	reads the description of the run any more and the next one can overwrite it.
+
+const unsigned int AUDIO_WORKER_SPIN = 4096;		// yields before a worker sleeps
+
+class AudioWorkerPool
+{
+	public :
+		typedef void (*Job)(void *p_data, unsigned int p_part);
+
+		explicit AudioWorkerPool(unsigned int p_workers) : m_job(nullptr), m_data(nullptr), m_parts(0), m_generation(0), m_pending(0), m_sleeping(0), m_quit(false)
+		{
+			for (unsigned int idx = 0; idx < p_workers; ++idx)
+			{
+				m_threads.push_back(std::thread(&AudioWorkerPool::worker_main, this, idx + 1));
+			}
+		}
+
+		~AudioWorkerPool()
+		{
+			m_quit.store(true);
+			wake();
+
+			for (std::thread &thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		unsigned int workers() const
+		{
+			return (unsigned int) m_threads.size();
+		}
+
+		// calls p_job for every part 0 .. p_parts - 1, at most workers() + 1 of them
+		void run(Job p_job, void *p_data, unsigned int p_parts)
+		{
+			if (p_parts > workers() + 1)
+				p_parts = workers() + 1;
+
+			if (p_parts > 1)
+			{
+				m_job = p_job;
+				m_data = p_data;
+				m_parts = p_parts;
+				m_pending.store(workers());
+				m_generation.fetch_add(1);
+				wake();
+			}
+
+			p_job(p_data, 0);
+
+			while (p_parts > 1 && m_pending.load() != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+	private :
+		void wake()
+		{
+			// a worker counts itself as sleeping before it checks the generation a last time, so either it sees the new
+			//	generation or this sees it sleeping
+			if (m_sleeping.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_wake.notify_all();
+			}
+		}
+
+		void worker_main(unsigned int p_part)
+		{
+			uint64_t seen = 0;
+
+			for (;;)
+			{
+				for (unsigned int spin = 0; spin < AUDIO_WORKER_SPIN && m_generation.load() == seen && !m_quit.load(); ++spin)
+				{
+					std::this_thread::yield();
+				}
+
+				if (m_generation.load() == seen && !m_quit.load())
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_sleeping.fetch_add(1);
+
+					while (m_generation.load() == seen && !m_quit.load())
+					{
+						m_wake.wait(lock);
+					}
+
+					m_sleeping.fetch_sub(1);
+				}
+
+				if (m_quit.load())
+					return;
+
+				seen = m_generation.load();
+
+				if (p_part < m_parts)
+				{
+					m_job(m_data, p_part);
+				}
+
+				m_pending.fetch_sub(1);
+			}
+		}
+
+	private :
+		std::vector<std::thread>	m_threads;
+		std::mutex					m_lock;
+		std::condition_variable		m_wake;
+
+		// the current run, written by the mixer before it bumps m_generation and kept until every worker acknowledged it
+		Job							m_job;
+		void *						m_data;
+		unsigned int				m_parts;
+
+		std::atomic<uint64_t>		m_generation;
+		std::atomic<unsigned int>	m_pending;		// workers that didn't finish the current run yet
+		std::atomic<unsigned int>	m_sleeping;
+		std::atomic<bool>			m_quit;
+};
+
+#endif // FAUDIOFILTERDEMO_AUDIO_WORKERS_H
@@ -4,11 +4,14 @@
 #include <xaudio2fx.h>
 #include "dr_wav.h"
 
+#include <math.h>
+
 struct AudioContext 
 {
 	IXAudio2 *xaudio2;
 	uint32_t	output_5p1;
 	IXAudio2MasteringVoice *mastering_voice;
+	uint32_t	quantum_frames;
 
 	unsigned int wav_channels;
 	unsigned int wav_samplerate;
@@ -18,16 +21,29 @@ struct AudioContext
 	struct AudioVoice *voice;
 	XAUDIO2_BUFFER    buffer;
 
+	// the reverb runs on a submix voice every source voice sends to, its cost doesn't depend on the number of voices
+	IXAudio2SubmixVoice *	  reverb_bus;
+	unsigned int			  bus_channels;
 	XAUDIO2_EFFECT_DESCRIPTOR reverb_effect;
 	XAUDIO2_EFFECT_CHAIN	  effect_chain;
 	ReverbParameters		  reverb_params;
 	bool					  reverb_enabled;
+
+	// between audio_begin_changes and audio_commit_changes every call is queued in an operation set, XAudio2 applies
+	//	the whole set in one pass
+	UINT32					  operation_set;		// the open batch or XAUDIO2_COMMIT_NOW
+	UINT32					  operation_last;
 };
 
 struct AudioVoice
 {
 	AudioContext *context;
 	IXAudio2SourceVoice *voice;
+
+	unsigned int channels;
+	float		 send_level;
+	float		 bus_matrix[2 * 2];			// default output matrices of the two sends, scaled by the send level
+	float		 master_matrix[2 * 6];
 };
 
 struct AudioFilter
@@ -38,28 +54,136 @@ struct AudioFilter
 
 void xaudio_destroy_context(AudioContext *p_context)
 {
+	if (p_context->voice)
+	{
+		audio_voice_destroy(p_context->voice);
+	}
+
+	if (p_context->reverb_bus)
+	{
+		p_context->reverb_bus->DestroyVoice();
+	}
+
 	p_context->mastering_voice->DestroyVoice();
 	p_context->xaudio2->Release();
 	delete p_context;
 }
 
-AudioVoice *xaudio_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels)
+void xaudio_reverb_set_params(AudioContext *context)
+{
+	XAUDIO2FX_REVERB_PARAMETERS native_params = { 0 };
+
+	native_params.WetDryMix = context->reverb_params.WetDryMix;
+	native_params.ReflectionsDelay = context->reverb_params.ReflectionsDelay;
+	native_params.ReverbDelay = context->reverb_params.ReverbDelay;
+	native_params.RearDelay = context->reverb_params.RearDelay;
+	native_params.PositionLeft = context->reverb_params.PositionLeft;
+	native_params.PositionRight = context->reverb_params.PositionRight;
+	native_params.PositionMatrixLeft = context->reverb_params.PositionMatrixLeft;
+	native_params.PositionMatrixRight = context->reverb_params.PositionMatrixRight;
+	native_params.EarlyDiffusion = context->reverb_params.EarlyDiffusion;
+	native_params.LateDiffusion = context->reverb_params.LateDiffusion;
+	native_params.LowEQGain = context->reverb_params.LowEQGain;
+	native_params.LowEQCutoff = context->reverb_params.LowEQCutoff;
+	native_params.HighEQGain = context->reverb_params.HighEQGain;
+	native_params.HighEQCutoff = context->reverb_params.HighEQCutoff;
+	native_params.RoomFilterFreq = context->reverb_params.RoomFilterFreq;
+	native_params.RoomFilterMain = context->reverb_params.RoomFilterMain;
+	native_params.RoomFilterHF = context->reverb_params.RoomFilterHF;
+	native_params.ReflectionsGain = context->reverb_params.ReflectionsGain;
+	native_params.ReverbGain = context->reverb_params.ReverbGain;
+	native_params.DecayTime = context->reverb_params.DecayTime;
+	native_params.Density = context->reverb_params.Density;
+	native_params.RoomSize = context->reverb_params.RoomSize;
+
+	/* 2.8+ only but zero-initialization catches this 
+	native_params.DisableLateField = 0; */
+
+	HRESULT hr = context->reverb_bus->SetEffectParameters(
+		0, 
+		&native_params,
+		sizeof(XAUDIO2FX_REVERB_PARAMETERS),
+		context->operation_set);
+}
+
+// (re)creates the reverb bus with p_channels in, no voice may send to the old bus anymore
+static bool xaudio_bus_create(AudioContext *p_context, unsigned int p_channels)
 {
+	if (p_context->reverb_bus)
+	{
+		p_context->reverb_bus->DestroyVoice();
+		p_context->reverb_bus = nullptr;
+		p_context->bus_channels = 0;
+	}
+
 	// create the effect chain
 	IUnknown *xapo = nullptr;
 	HRESULT hr = XAudio2CreateReverb(&xapo);
 
 	if (FAILED(hr))
-		return nullptr;
+		return false;
 
 	// create effect chain
 	p_context->reverb_effect.InitialState = p_context->reverb_enabled;
-	p_context->reverb_effect.OutputChannels = (p_context->output_5p1) ? 6 : p_context->wav_channels;
+	p_context->reverb_effect.OutputChannels = (p_context->output_5p1) ? 6 : p_channels;
 	p_context->reverb_effect.pEffect = xapo;
 
 	p_context->effect_chain.EffectCount = 1;
 	p_context->effect_chain.pEffectDescriptors = &p_context->reverb_effect;
 
+	// create a submix voice at the rate of the mastering voice, it outputs to the mastering voice
+	XAUDIO2_VOICE_DETAILS master_details;
+	p_context->mastering_voice->GetVoiceDetails(&master_details);
+
+	IXAudio2SubmixVoice *bus;
+	hr = p_context->xaudio2->CreateSubmixVoice(&bus, p_channels, master_details.InputSampleRate, 0, 0, nullptr, &p_context->effect_chain);
+	xapo->Release();
+
+	if (FAILED(hr))
+		return false;
+
+	p_context->reverb_bus = bus;
+	p_context->bus_channels = p_channels;
+	xaudio_reverb_set_params(p_context);
+	return true;
+}
+
+void xaudio_voice_set_send_level(AudioVoice *p_voice, float p_level)
+{
+	AudioContext *context = p_voice->context;
+	unsigned int master_channels = context->output_5p1 ? 6 : 2;
+
+	p_voice->send_level = fminf(fmaxf(p_level, 0.0f), 1.0f);
+
+	float bus_matrix[2 * 2];
+	float master_matrix[2 * 6];
+
+	for (unsigned int idx = 0; idx < p_voice->channels * context->bus_channels; ++idx)
+		bus_matrix[idx] = p_voice->bus_matrix[idx] * p_voice->send_level;
+
+	for (unsigned int idx = 0; idx < p_voice->channels * master_channels; ++idx)
+		master_matrix[idx] = p_voice->master_matrix[idx] * (1.0f - p_voice->send_level);
+
+	p_voice->voice->SetOutputMatrix(context->reverb_bus, p_voice->channels, context->bus_channels, bus_matrix, context->operation_set);
+	p_voice->voice->SetOutputMatrix(context->mastering_voice, p_voice->channels, master_channels, master_matrix, context->operation_set);
+}
+
+AudioVoice *xaudio_create_voice(AudioContext *p_context, float *p_buffer, size_t p_buffer_size, int p_sample_rate, int p_num_channels)
+{
+	if (p_context->reverb_bus == nullptr)
+		return nullptr;
+
+	// send to the reverb bus and straight to the mastering voice, the send level splits the voice between the two
+	XAUDIO2_SEND_DESCRIPTOR sends[2];
+	sends[0].Flags = 0;
+	sends[0].pOutputVoice = p_context->reverb_bus;
+	sends[1].Flags = 0;
+	sends[1].pOutputVoice = p_context->mastering_voice;
+
+	XAUDIO2_VOICE_SENDS send_list;
+	send_list.SendCount = 2;
+	send_list.pSends = sends;
+
 	// create a source voice
 	WAVEFORMATEX waveFormat;
 	waveFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
@@ -71,8 +195,7 @@ AudioVoice *xaudio_create_voice(AudioContext *p_context, float *p_buffer, size_t
 	waveFormat.cbSize = 0;
 
 	IXAudio2SourceVoice *voice;
-	hr = p_context->xaudio2->CreateSourceVoice(&voice, &waveFormat, XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, nullptr, nullptr, &p_context->effect_chain);
-	xapo->Release();
+	HRESULT hr = p_context->xaudio2->CreateSourceVoice(&voice, &waveFormat, XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, nullptr, &send_list, nullptr);
 
 	if (FAILED(hr)) {
 		return nullptr;
@@ -95,60 +218,31 @@ AudioVoice *xaudio_create_voice(AudioContext *p_context, float *p_buffer, size_t
 	AudioVoice *result = new AudioVoice();
 	result->context = p_context;
 	result->voice = voice;
-	return result;
-}
-
-void xaudio_reverb_set_params(AudioContext *context)
-{
-	XAUDIO2FX_REVERB_PARAMETERS native_params = { 0 };
-
-	native_params.WetDryMix = context->reverb_params.WetDryMix;
-	native_params.ReflectionsDelay = context->reverb_params.ReflectionsDelay;
-	native_params.ReverbDelay = context->reverb_params.ReverbDelay;
-	native_params.RearDelay = context->reverb_params.RearDelay;
-	native_params.PositionLeft = context->reverb_params.PositionLeft;
-	native_params.PositionRight = context->reverb_params.PositionRight;
-	native_params.PositionMatrixLeft = context->reverb_params.PositionMatrixLeft;
-	native_params.PositionMatrixRight = context->reverb_params.PositionMatrixRight;
-	native_params.EarlyDiffusion = context->reverb_params.EarlyDiffusion;
-	native_params.LateDiffusion = context->reverb_params.LateDiffusion;
-	native_params.LowEQGain = context->reverb_params.LowEQGain;
-	native_params.LowEQCutoff = context->reverb_params.LowEQCutoff;
-	native_params.HighEQGain = context->reverb_params.HighEQGain;
-	native_params.HighEQCutoff = context->reverb_params.HighEQCutoff;
-	native_params.RoomFilterFreq = context->reverb_params.RoomFilterFreq;
-	native_params.RoomFilterMain = context->reverb_params.RoomFilterMain;
-	native_params.RoomFilterHF = context->reverb_params.RoomFilterHF;
-	native_params.ReflectionsGain = context->reverb_params.ReflectionsGain;
-	native_params.ReverbGain = context->reverb_params.ReverbGain;
-	native_params.DecayTime = context->reverb_params.DecayTime;
-	native_params.Density = context->reverb_params.Density;
-	native_params.RoomSize = context->reverb_params.RoomSize;
+	result->channels = p_num_channels;
 
-	/* 2.8+ only but zero-initialization catches this 
-	native_params.DisableLateField = 0; */
+	voice->GetOutputMatrix(p_context->reverb_bus, p_num_channels, p_context->bus_channels, result->bus_matrix);
+	voice->GetOutputMatrix(p_context->mastering_voice, p_num_channels, p_context->output_5p1 ? 6 : 2, result->master_matrix);
+	xaudio_voice_set_send_level(result, 1.0f);
 
-	HRESULT hr = context->voice->voice->SetEffectParameters(
-		0, 
-		&native_params,
-		sizeof(XAUDIO2FX_REVERB_PARAMETERS));
+	return result;
 }
 
-
 void xaudio_voice_destroy(AudioVoice *p_voice)
 {
 	drwav_free(p_voice->context->wav_samples);
+	p_voice->context->wav_samples = NULL;
 	p_voice->voice->DestroyVoice();
+	delete p_voice;
 }
 
 void xaudio_voice_set_volume(AudioVoice *p_voice, float p_volume)
 {
-	p_voice->voice->SetVolume(p_volume);
+	p_voice->voice->SetVolume(p_volume, p_voice->context->operation_set);
 }
 
 void xaudio_voice_set_frequency(AudioVoice *p_voice, float p_frequency)
 {
-	p_voice->voice->SetFrequencyRatio(p_frequency);
+	p_voice->voice->SetFrequencyRatio(p_frequency, p_voice->context->operation_set);
 }
 
 void xaudio_wave_load(AudioContext *p_context, AudioSampleWave sample, bool stereo)
@@ -156,6 +250,7 @@ void xaudio_wave_load(AudioContext *p_context, AudioSampleWave sample, bool ster
 	if (p_context->voice)
 	{
 		audio_voice_destroy(p_context->voice);
+		p_context->voice = NULL;
 	}
 
 	p_context->wav_samples = drwav_open_and_read_file_f32(
@@ -164,14 +259,29 @@ void xaudio_wave_load(AudioContext *p_context, AudioSampleWave sample, bool ster
 		&p_context->wav_samplerate,
 		&p_context->wav_sample_count);
 
+	if (p_context->wav_samples == NULL)
+	{
+		return;
+	}
+
 	p_context->wav_sample_count /= p_context->wav_channels;
 
+	// the bus takes the channel count of the wave, a tail still ringing on it carries on into the new sample
+	if (p_context->reverb_bus == nullptr || p_context->bus_channels != p_context->wav_channels)
+	{
+		xaudio_bus_create(p_context, p_context->wav_channels);
+	}
+
 	p_context->voice = audio_create_voice(p_context, p_context->wav_samples, p_context->wav_sample_count, p_context->wav_samplerate, p_context->wav_channels);
-	xaudio_reverb_set_params(p_context);
 }
 
 void xaudio_wave_play(AudioContext *p_context)
 {
+	if (p_context->voice == NULL)
+	{
+		return;
+	}
+
 	p_context->voice->voice->Stop();
 	p_context->voice->voice->FlushSourceBuffers();
 
@@ -184,27 +294,124 @@ void xaudio_wave_play(AudioContext *p_context)
 	p_context->voice->voice->Start();
 }
 
-void xaudio_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params)
+bool xaudio_wave_playing(AudioContext *p_context)
+{
+	if (p_context->voice == NULL)
+	{
+		return false;
+	}
+
+	XAUDIO2_VOICE_STATE state;
+	p_context->voice->voice->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+	return state.BuffersQueued > 0;
+}
+
+bool xaudio_automation_play(AudioContext *p_context, const AudioAutomationEvent *p_events, size_t p_count)
+{
+	// nothing runs on the mixing thread of XAudio2 to apply the events at their frame
+	return false;
+}
+
+bool xaudio_set_tail_mode(AudioContext *p_context, AudioTailMode p_mode)
+{
+	// the effect keeps running on the started voice after its buffer, there is no silence to size
+	return p_mode == AudioTailMode_Fixed;
+}
+
+void xaudio_effect_change(AudioContext *p_context, bool p_enabled, ReverbParameters *p_params, uint32_t p_changed)
 {
 	HRESULT hr;
 
 	if (p_context->reverb_enabled && !p_enabled)
 	{
-		hr = p_context->voice->voice->DisableEffect(0);
+		hr = p_context->reverb_bus->DisableEffect(0, p_context->operation_set);
 		p_context->reverb_enabled = p_enabled;
 	}
 	else if (!p_context->reverb_enabled && p_enabled)
 	{
-		hr = p_context->voice->voice->EnableEffect(0);
+		hr = p_context->reverb_bus->EnableEffect(0, p_context->operation_set);
 		p_context->reverb_enabled = p_enabled;
 	}
 
-	memcpy(&p_context->reverb_params, p_params, sizeof(ReverbParameters));
-	xaudio_reverb_set_params(p_context);
+	// toggling the effect doesn't resend the parameters
+	if (p_changed != 0)
+	{
+		memcpy(&p_context->reverb_params, p_params, sizeof(ReverbParameters));
+		xaudio_reverb_set_params(p_context);
+	}
+}
+
+void xaudio_effect_morph(AudioContext *p_context, const ReverbParameters *p_target, float p_seconds)
+{
+	// there is no callback on the mixing thread to step the parameters from, go to the target at once
+	ReverbParameters params = *p_target;
+	xaudio_effect_change(p_context, p_context->reverb_enabled, &params, audio_reverb_changed_fields(&p_context->reverb_params, p_target));
+}
+
+void xaudio_begin_changes(AudioContext *p_context)
+{
+	// set numbers start at 1, XAUDIO2_COMMIT_NOW is 0
+	if (p_context->operation_set == XAUDIO2_COMMIT_NOW)
+		p_context->operation_set = (p_context->operation_last == UINT32_MAX) ? 1 : p_context->operation_last + 1;
 }
 
+void xaudio_commit_changes(AudioContext *p_context)
+{
+	if (p_context->operation_set == XAUDIO2_COMMIT_NOW)
+		return;
+
+	p_context->xaudio2->CommitChanges(p_context->operation_set);
+	p_context->operation_last = p_context->operation_set;
+	p_context->operation_set = XAUDIO2_COMMIT_NOW;
+}
 
-AudioContext *xaudio_create_context(bool output_5p1)
+size_t xaudio_render(AudioContext *p_context, float *p_output, size_t p_frames)
+{
+	// XAudio2 renders on its own thread straight to the device
+	return 0;
+}
+
+size_t xaudio_bytes_in_use(AudioContext *p_context)
+{
+	size_t result = sizeof(AudioContext);
+
+	if (p_context->wav_samples)
+		result += p_context->wav_sample_count * p_context->wav_channels * sizeof(float);
+	if (p_context->voice)
+		result += sizeof(AudioVoice);
+
+	return result;
+}
+
+double xaudio_trigger_latency(AudioContext *p_context, AudioTrigger p_trigger)
+{
+	// not instrumented
+	return -1.0;
+}
+
+size_t xaudio_quantum_times(AudioContext *p_context, float *p_times, size_t p_max)
+{
+	// not instrumented
+	return 0;
+}
+
+uint32_t xaudio_quantum_frames(AudioContext *p_context)
+{
+	return p_context->quantum_frames;
+}
+
+bool xaudio_effect_set_mode(AudioContext *p_context, AudioEffectMode p_mode)
+{
+	return p_mode == AudioEffectMode_Algorithmic;
+}
+
+size_t xaudio_effect_mode_times(AudioContext *p_context, AudioEffectMode p_mode, float *p_times, size_t p_max)
+{
+	// not instrumented
+	return 0;
+}
+
+AudioContext *xaudio_create_context(bool output_5p1, uint32_t p_quantum)
 {
 	// setup function pointers
 	audio_destroy_context = xaudio_destroy_context;
@@ -212,16 +419,43 @@ AudioContext *xaudio_create_context(bool output_5p1)
 	audio_voice_destroy = xaudio_voice_destroy;
 	audio_voice_set_volume = xaudio_voice_set_volume;
 	audio_voice_set_frequency = xaudio_voice_set_frequency;
+	audio_voice_set_send_level = xaudio_voice_set_send_level;
 
 	audio_wave_load = xaudio_wave_load;
 	audio_wave_play = xaudio_wave_play;
+	audio_wave_playing = xaudio_wave_playing;
+	audio_automation_play = xaudio_automation_play;
+	audio_set_tail_mode = xaudio_set_tail_mode;
 
 	audio_effect_change = xaudio_effect_change;
+	audio_effect_morph = xaudio_effect_morph;
+	audio_effect_set_mode = xaudio_effect_set_mode;
+	audio_effect_mode_times = xaudio_effect_mode_times;
+	audio_begin_changes = xaudio_begin_changes;
+	audio_commit_changes = xaudio_commit_changes;
+
+	audio_render = xaudio_render;
+	audio_trigger_latency = xaudio_trigger_latency;
+	audio_bytes_in_use = xaudio_bytes_in_use;
+	audio_quantum_times = xaudio_quantum_times;
+	audio_quantum_frames = xaudio_quantum_frames;
+
+	// XAudio2 mixes 10 ms, or 21.33 ms with XAUDIO2_1024_QUANTUM: take the one closer to the request
+	UINT32 flags = 0;
+	uint32_t quantum_frames = AUDIO_DEFAULT_QUANTUM;
+
+	#ifdef XAUDIO2_1024_QUANTUM
+	if (p_quantum > (AUDIO_DEFAULT_QUANTUM + AUDIO_LONG_QUANTUM) / 2)
+	{
+		flags |= XAUDIO2_1024_QUANTUM;
+		quantum_frames = AUDIO_LONG_QUANTUM;
+	}
+	#endif
 
 	// create XAudio object
 	IXAudio2 *xaudio2;
 
-	HRESULT hr = XAudio2Create(&xaudio2);
+	HRESULT hr = XAudio2Create(&xaudio2, flags);
 	if (FAILED(hr))
 		return nullptr;
 
@@ -237,10 +471,15 @@ AudioContext *xaudio_create_context(bool output_5p1)
 	context->xaudio2 = xaudio2;
 	context->output_5p1 = output_5p1;
 	context->mastering_voice = mastering_voice;
+	context->quantum_frames = quantum_frames;
 	context->voice = NULL;
+	context->reverb_bus = nullptr;
+	context->bus_channels = 0;
 	context->wav_samples = NULL;
 	context->reverb_params = audio_reverb_presets[0];
 	context->reverb_enabled = false;
+	context->operation_set = XAUDIO2_COMMIT_NOW;
+	context->operation_last = 0;
 
 	// load the first wave
 	audio_wave_load(context, (AudioSampleWave) 0, false);
@@ -0,0 +1,265 @@
+// reverb throughput benchmark: renders a sample through every reverb preset with the offline engine, for mono and
+//	stereo sources and for stereo and 5.1 output, and reports the cost of each case as JSON.
+
+#include "audio.h"
+#include "native_ir_cache.h"
+#include "native_reverb.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct BenchResult
+{
+	size_t preset;
+	bool   stereo;
+	bool   output_5p1;
+	size_t frames;
+	double seconds;
+};
+
+static void print_usage(const char *p_program)
+{
+	printf("Usage: %s [options]\n", p_program);
+	printf("  -s <index>    sample to render (0 - 2, default 0)\n");
+	printf("  -n <count>    number of runs per case, the fastest run is reported (default 5)\n");
+	printf("  -o <file>     output json file (default bench.json)\n");
+	printf("  -q <frames>   processing quantum of the engine (%u - %u, default %u)\n", AUDIO_MIN_QUANTUM, AUDIO_MAX_QUANTUM, AUDIO_DEFAULT_QUANTUM);
+	printf("  --native      benchmark the built-in reverb instead of the FAudio one\n");
+	printf("  --convolution benchmark the convolution mode of the built-in reverb (with --native)\n");
+	printf("  --tail-aware  stop every case once its reverb tail died out instead of after 2 seconds of silence\n");
+	printf("  --kernels <k> inner loops of the built-in reverb: scalar, sse2, avx2 or avx512 (default: widest supported)\n");
+	printf("  --delay-format <f> delay memory of the built-in reverb: float, half or int16 (default float)\n");
+	printf("  --ir-cache <f> keep the impulse responses of the convolution mode in file <f> across runs\n");
+	printf("  --threads <n> extra threads of the built-in reverb for 5.1 (default: cores - 1)\n");
+}
+
+static BenchResult bench_case(AudioContext *p_context, size_t p_preset, bool p_stereo, bool p_output_5p1, int p_sample, int p_runs)
+{
+	BenchResult result = {p_preset, p_stereo, p_output_5p1, 0, 0.0};
+
+	unsigned int output_channels = p_output_5p1 ? 6 : 2;
+	size_t quantum_frames = audio_quantum_frames(p_context);
+	std::vector<float> quantum(quantum_frames * output_channels);
+
+	ReverbParameters reverb_params = audio_reverb_presets[p_preset];
+
+	for (int run = 0; run < p_runs; ++run)
+	{
+		// start every run from a freshly loaded voice so the effect has no state left from the previous run
+		audio_wave_load(p_context, (AudioSampleWave) p_sample, p_stereo);
+		audio_effect_change(p_context, true, &reverb_params, AudioReverbField_All);
+		audio_wave_play(p_context);
+
+		size_t frames = 0;
+		auto start_time = std::chrono::steady_clock::now();
+
+		while (audio_wave_playing(p_context))
+		{
+			frames += audio_render(p_context, quantum.data(), quantum_frames);
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		if (run == 0 || seconds < result.seconds)
+		{
+			result.frames = frames;
+			result.seconds = seconds;
+		}
+	}
+
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	int sample_index = 0;
+	int runs = 5;
+	int quantum = AUDIO_DEFAULT_QUANTUM;
+	int threads = -1;
+	uint32_t quantum_frames = 0;
+	const char *output_filename = "bench.json";
+	AudioEngine engine = AudioEngine_Offline;
+	AudioEffectMode effect_mode = AudioEffectMode_Algorithmic;
+	AudioTailMode tail_mode = AudioTailMode_Fixed;
+	const char *kernels = nullptr;
+	const char *delay_format = nullptr;
+	const char *ir_cache = nullptr;
+
+	// parse the command line
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		if (strcmp(argv[idx], "-s") == 0 && idx + 1 < argc)
+			sample_index = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-n") == 0 && idx + 1 < argc)
+			runs = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-o") == 0 && idx + 1 < argc)
+			output_filename = argv[++idx];
+		else if (strcmp(argv[idx], "-q") == 0 && idx + 1 < argc)
+			quantum = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "--native") == 0)
+			engine = AudioEngine_Native;
+		else if (strcmp(argv[idx], "--convolution") == 0)
+			effect_mode = AudioEffectMode_Convolution;
+		else if (strcmp(argv[idx], "--tail-aware") == 0)
+			tail_mode = AudioTailMode_Decay;
+		else if (strcmp(argv[idx], "--kernels") == 0 && idx + 1 < argc)
+			kernels = argv[++idx];
+		else if (strcmp(argv[idx], "--delay-format") == 0 && idx + 1 < argc)
+			delay_format = argv[++idx];
+		else if (strcmp(argv[idx], "--ir-cache") == 0 && idx + 1 < argc)
+			ir_cache = argv[++idx];
+		else if (strcmp(argv[idx], "--threads") == 0 && idx + 1 < argc)
+			threads = atoi(argv[++idx]);
+		else
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (sample_index < 0 || sample_index > AudioWave_SnareDrum03 || runs < 1 ||
+		quantum < (int) AUDIO_MIN_QUANTUM || quantum > (int) AUDIO_MAX_QUANTUM)
+	{
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	if (kernels != nullptr && !native_reverb_select_kernels(kernels))
+	{
+		printf("Error: the %s reverb kernels are unknown or not supported by this CPU\n", kernels);
+		return -1;
+	}
+
+	if (delay_format != nullptr && !native_reverb_select_delay_format(delay_format))
+	{
+		printf("Error: unknown delay format %s\n", delay_format);
+		return -1;
+	}
+
+	if (ir_cache != nullptr && !native_ir_cache_open(ir_cache))
+	{
+		printf("Error: unable to open the impulse response cache %s\n", ir_cache);
+		return -1;
+	}
+
+	// run all cases
+	std::vector<BenchResult> results;
+	size_t bytes_in_use[2] = { 0, 0 };
+
+	for (int layout = 0; layout < 2; ++layout)
+	{
+		bool output_5p1 = (layout == 1);
+		AudioContext *context = audio_create_context(engine, output_5p1, quantum, (threads >= 0) ? (unsigned int) threads : AUDIO_AUTO_WORKERS);
+
+		if (context == nullptr)
+		{
+			printf("Error: unable to create the audio engine\n");
+			return -1;
+		}
+
+		quantum_frames = audio_quantum_frames(context);
+
+		if (!audio_effect_set_mode(context, effect_mode))
+		{
+			printf("Error: only the native engine has a convolution mode\n");
+			return -1;
+		}
+
+		// with a cache the presets are captured before anything is timed
+		if (effect_mode == AudioEffectMode_Convolution)
+			native_ir_cache_precompute(AUDIO_MASTER_SAMPLERATE, output_5p1 ? 6 : 2);
+
+		audio_set_tail_mode(context, tail_mode);
+
+		for (int source = 0; source < 2; ++source)
+		{
+			for (size_t preset = 0; preset < audio_reverb_preset_count; ++preset)
+			{
+				results.push_back(bench_case(context, preset, source == 1, output_5p1, sample_index, runs));
+			}
+		}
+
+		bytes_in_use[layout] = audio_bytes_in_use(context);
+
+		audio_destroy_context(context);
+	}
+
+	native_ir_cache_close();
+
+	// report
+	FILE *json = fopen(output_filename, "w");
+
+	if (json == NULL)
+	{
+		printf("Error: unable to create %s\n", output_filename);
+		return -1;
+	}
+
+	fprintf(json, "{\n");
+	fprintf(json, "\t\"engine\": \"%s\",\n", (engine == AudioEngine_Native) ? "native" : "offline");
+	if (engine == AudioEngine_Native)
+	{
+		fprintf(json, "\t\"kernels\": \"%s\",\n", native_reverb_kernels_name());
+		fprintf(json, "\t\"delay_format\": \"%s\",\n", native_reverb_delay_format_name());
+		if (threads >= 0)
+			fprintf(json, "\t\"threads\": %d,\n", threads);
+		else
+			fprintf(json, "\t\"threads\": \"auto\",\n");
+	}
+	fprintf(json, "\t\"mode\": \"%s\",\n", (effect_mode == AudioEffectMode_Convolution) ? "convolution" : "algorithmic");
+	fprintf(json, "\t\"tail\": \"%s\",\n", (tail_mode == AudioTailMode_Decay) ? "decay" : "fixed");
+	fprintf(json, "\t\"sample_rate\": %u,\n", AUDIO_MASTER_SAMPLERATE);
+	fprintf(json, "\t\"quantum\": %u,\n", quantum_frames);
+	fprintf(json, "\t\"quantum_latency_ms\": %.3f,\n", quantum_frames * 1000.0 / AUDIO_MASTER_SAMPLERATE);
+	fprintf(json, "\t\"bytes_in_use\": {\"2ch\": %zu, \"5.1\": %zu},\n", bytes_in_use[0], bytes_in_use[1]);
+	fprintf(json, "\t\"runs\": %d,\n", runs);
+	fprintf(json, "\t\"results\": [\n");
+
+	printf("quantum: %u frames, %.2f ms of buffering\n", quantum_frames, quantum_frames * 1000.0 / AUDIO_MASTER_SAMPLERATE);
+	printf("engine memory: %zu bytes (2ch), %zu bytes (5.1)\n", bytes_in_use[0], bytes_in_use[1]);
+	printf("%-18s %-7s %-7s %12s %14s %10s\n", "preset", "source", "output", "ns/sample", "samples/s", "realtime");
+
+	for (size_t idx = 0; idx < results.size(); ++idx)
+	{
+		const BenchResult &r = results[idx];
+
+		double ns_per_sample = r.seconds * 1e9 / r.frames;
+		double samples_per_second = r.frames / r.seconds;
+		double realtime_factor = samples_per_second / AUDIO_MASTER_SAMPLERATE;
+
+		printf("%-18s %-7s %-7s %12.1f %14.0f %9.1fx\n",
+			audio_reverb_preset_names[r.preset], r.stereo ? "stereo" : "mono", r.output_5p1 ? "5.1" : "2ch",
+			ns_per_sample, samples_per_second, realtime_factor);
+
+		// the stereo cases load the stereo file of the sample
+		const char *sample = r.stereo ? audio_stereo_filenames[sample_index] : audio_sample_filenames[sample_index];
+
+		fprintf(json, "\t\t{\"preset\": \"%s\", \"sample\": \"%s\", \"source\": \"%s\", \"output\": \"%s\", \"frames\": %zu, "
+					  "\"ns_per_sample\": %.3f, \"samples_per_second\": %.1f, \"realtime_factor\": %.3f}%s\n",
+			audio_reverb_preset_names[r.preset], sample, r.stereo ? "stereo" : "mono", r.output_5p1 ? "5.1" : "2ch", r.frames,
+			ns_per_sample, samples_per_second, realtime_factor, (idx + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(json, "\t]\n");
+	fprintf(json, "}\n");
+	fclose(json);
+
+	// the tail mode changes how much is rendered, not how fast: compare the totals
+	size_t total_frames = 0;
+	double total_seconds = 0.0;
+
+	for (const BenchResult &r : results)
+	{
+		total_frames += r.frames;
+		total_seconds += r.seconds;
+	}
+
+	printf("total: %zu frames in %.3f s (%s tail)\n", total_frames, total_seconds, (tail_mode == AudioTailMode_Decay) ? "decay" : "fixed");
+
+	printf("results written to %s\n", output_filename);
+
+	return 0;
+}
@@ -0,0 +1,254 @@
+// self checks of the parts that the renders of the regression test can't cover: stress tests the mailbox between the API
+//	thread and the mixer, and checks that the incremental coefficient updates of the built-in reverb match a full
+//	computation. Build with 'make check SANITIZE=thread' to run the mailbox under ThreadSanitizer.
+
+#include "audio.h"
+#include "audio_mailbox.h"
+#include "native_reverb.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+static void print_usage(const char *p_program)
+{
+	printf("Usage: %s [options]\n", p_program);
+	printf("  -m <count>        messages posted through the mailbox (default 2000000)\n");
+	printf("  -e <count>        random parameter edits compared to a full computation (default 200000)\n");
+	printf("  -r <seed>         seed of the random edits (default 1)\n");
+}
+
+// mailbox
+
+const unsigned int CHECK_MESSAGE_WORDS = 16;
+const uint64_t CHECK_MAILBOX_YIELD = 64;		// posts between two yields of the producer
+
+// every word holds the serial, a message torn between two posts has words of both
+struct CheckMessage
+{
+	uint64_t words[CHECK_MESSAGE_WORDS];
+};
+
+static bool check_mailbox(uint64_t p_messages)
+{
+	AudioMailbox<CheckMessage> mailbox;
+	uint64_t fetched = 0;
+	uint64_t torn = 0;
+	uint64_t out_of_order = 0;
+
+	// the consumer runs until it saw the last message, which a mailbox never drops
+	std::thread consumer([&]() {
+		uint64_t last = 0;
+
+		while (last != p_messages)
+		{
+			const CheckMessage *message = mailbox.fetch();
+
+			if (message == nullptr)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			for (unsigned int word = 1; word < CHECK_MESSAGE_WORDS; ++word)
+			{
+				if (message->words[word] != message->words[0])
+				{
+					++torn;
+					break;
+				}
+			}
+
+			if (message->words[0] <= last)
+				++out_of_order;
+
+			last = message->words[0];
+			++fetched;
+		}
+	});
+
+	for (uint64_t serial = 1; serial <= p_messages; ++serial)
+	{
+		CheckMessage message;
+
+		for (unsigned int word = 0; word < CHECK_MESSAGE_WORDS; ++word)
+		{
+			message.words[word] = serial;
+		}
+
+		mailbox.publish(message);
+
+		// gives the consumer a turn now and then when both share a core
+		if (serial % CHECK_MAILBOX_YIELD == 0)
+			std::this_thread::yield();
+	}
+
+	consumer.join();
+
+	bool result = torn == 0 && out_of_order == 0;
+	printf("%s mailbox: %llu messages posted, %llu fetched, %llu torn, %llu out of order\n", result ? "ok  " : "FAIL",
+		   (unsigned long long) p_messages, (unsigned long long) fetched, (unsigned long long) torn, (unsigned long long) out_of_order);
+	return result;
+}
+
+// coefficients
+
+enum CheckFieldType {
+	CheckField_Float,
+	CheckField_UInt8,
+	CheckField_UInt32
+};
+
+// a field of ReverbParameters and the range of valid values
+struct CheckField
+{
+	size_t		   offset;
+	CheckFieldType type;
+	float		   min;
+	float		   max;
+};
+
+#define CHECK_FIELD(name, type, min, max) { offsetof(ReverbParameters, name), type, min, max }
+
+static const CheckField check_fields[] =
+{
+	CHECK_FIELD(WetDryMix, CheckField_Float, 0.0f, 100.0f),
+	CHECK_FIELD(ReflectionsDelay, CheckField_UInt32, 0.0f, 300.0f),
+	CHECK_FIELD(ReverbDelay, CheckField_UInt8, 0.0f, 85.0f),
+	CHECK_FIELD(RearDelay, CheckField_UInt8, 0.0f, 20.0f),
+	CHECK_FIELD(PositionLeft, CheckField_UInt8, 0.0f, 30.0f),
+	CHECK_FIELD(PositionRight, CheckField_UInt8, 0.0f, 30.0f),
+	CHECK_FIELD(PositionMatrixLeft, CheckField_UInt8, 0.0f, 30.0f),
+	CHECK_FIELD(PositionMatrixRight, CheckField_UInt8, 0.0f, 30.0f),
+	CHECK_FIELD(EarlyDiffusion, CheckField_UInt8, 0.0f, 15.0f),
+	CHECK_FIELD(LateDiffusion, CheckField_UInt8, 0.0f, 15.0f),
+	CHECK_FIELD(LowEQGain, CheckField_UInt8, 0.0f, 12.0f),
+	CHECK_FIELD(LowEQCutoff, CheckField_UInt8, 0.0f, 9.0f),
+	CHECK_FIELD(HighEQGain, CheckField_UInt8, 0.0f, 8.0f),
+	CHECK_FIELD(HighEQCutoff, CheckField_UInt8, 0.0f, 14.0f),
+	CHECK_FIELD(RoomFilterFreq, CheckField_Float, 20.0f, 20000.0f),
+	CHECK_FIELD(RoomFilterMain, CheckField_Float, -100.0f, 0.0f),
+	CHECK_FIELD(RoomFilterHF, CheckField_Float, -100.0f, 0.0f),
+	CHECK_FIELD(ReflectionsGain, CheckField_Float, -100.0f, 20.0f),
+	CHECK_FIELD(ReverbGain, CheckField_Float, -100.0f, 20.0f),
+	CHECK_FIELD(DecayTime, CheckField_Float, 0.1f, 15.0f),
+	CHECK_FIELD(Density, CheckField_Float, 0.0f, 100.0f),
+	CHECK_FIELD(RoomSize, CheckField_Float, 1.0f, 100.0f),
+};
+
+static const size_t check_field_count = sizeof(check_fields) / sizeof(check_fields[0]);
+
+static float check_random(float p_min, float p_max)
+{
+	return p_min + (p_max - p_min) * ((float) rand() / (float) RAND_MAX);
+}
+
+// sets one random field to a random valid value, the integer fields are rounded
+static void check_random_edit(ReverbParameters *p_params)
+{
+	const CheckField &field = check_fields[rand() % check_field_count];
+	uint8_t *target = (uint8_t *) p_params + field.offset;
+	float value = check_random(field.min, field.max);
+
+	if (field.type == CheckField_Float)
+	{
+		memcpy(target, &value, sizeof(value));
+	}
+	else if (field.type == CheckField_UInt8)
+	{
+		uint8_t rounded = (uint8_t) (value + 0.5f);
+		memcpy(target, &rounded, sizeof(rounded));
+	}
+	else
+	{
+		uint32_t rounded = (uint32_t) (value + 0.5f);
+		memcpy(target, &rounded, sizeof(rounded));
+	}
+}
+
+static bool check_coefficients(uint64_t p_edits)
+{
+	NativeReverb *reverb = native_reverb_create(AUDIO_MASTER_SAMPLERATE, 1, 2, AUDIO_DEFAULT_QUANTUM);
+
+	ReverbParameters params = audio_reverb_presets[0];
+	native_reverb_set_params(reverb, &params);
+
+	// updated only with the fields that changed, like audio_effect_change passes them on
+	NativeReverbCoefficients incremental;
+	native_reverb_compute_coefficients(&params, AUDIO_MASTER_SAMPLERATE, &incremental);
+
+	uint64_t reverb_errors = 0;
+	uint64_t field_errors = 0;
+	uint64_t preset_switches = 0;
+
+	for (uint64_t edit = 0; edit < p_edits; ++edit)
+	{
+		ReverbParameters previous = params;
+
+		// mostly single fields like the sliders of the GUI, now and then a preset
+		if (rand() % 10 == 0)
+		{
+			params = audio_reverb_presets[rand() % audio_reverb_preset_count];
+			++preset_switches;
+		}
+		else
+		{
+			check_random_edit(&params);
+		}
+
+		native_reverb_set_params(reverb, &params);
+		native_reverb_compute_coefficients(&params, AUDIO_MASTER_SAMPLERATE, &incremental, audio_reverb_changed_fields(&previous, &params));
+
+		NativeReverbCoefficients full;
+		memset(&full, 0, sizeof(full));
+		native_reverb_compute_coefficients(&params, AUDIO_MASTER_SAMPLERATE, &full);
+
+		if (memcmp(native_reverb_coefficients(reverb), &full, sizeof(full)) != 0)
+			++reverb_errors;
+
+		if (memcmp(&incremental, &full, sizeof(full)) != 0)
+			++field_errors;
+	}
+
+	native_reverb_destroy(reverb);
+
+	bool result = reverb_errors == 0 && field_errors == 0;
+	printf("%s coefficients: %llu edits (%llu preset switches), %llu differ after native_reverb_set_params, %llu after a partial computation\n",
+		   result ? "ok  " : "FAIL", (unsigned long long) p_edits, (unsigned long long) preset_switches,
+		   (unsigned long long) reverb_errors, (unsigned long long) field_errors);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t messages = 2000000;
+	uint64_t edits = 200000;
+	unsigned int seed = 1;
+
+	// parse the command line
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		if (strcmp(argv[idx], "-m") == 0 && idx + 1 < argc)
+			messages = strtoull(argv[++idx], nullptr, 10);
+		else if (strcmp(argv[idx], "-e") == 0 && idx + 1 < argc)
+			edits = strtoull(argv[++idx], nullptr, 10);
+		else if (strcmp(argv[idx], "-r") == 0 && idx + 1 < argc)
+			seed = (unsigned int) strtoul(argv[++idx], nullptr, 10);
+		else
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	srand(seed);
+
+	int failures = 0;
+	failures += check_mailbox(messages) ? 0 : 1;
+	failures += check_coefficients(edits) ? 0 : 1;
+
+	printf("%d failures\n", failures);
+	return (failures == 0) ? 0 : 1;
+}
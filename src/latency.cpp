@@ -0,0 +1,137 @@
+// trigger latency harness: fires audio_wave_play / audio_effect_change many times and reports percentiles of the time
+//	until the engine mixed the first quantum that reflects the call.
+
+#include "audio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+const double LATENCY_TIMEOUT = 1.0;		// seconds to wait for a trigger before counting it as missed
+
+static void print_usage(const char *p_program)
+{
+	printf("Usage: %s [options]\n", p_program);
+	printf("  -n <count>    number of triggers per measurement (default 2000)\n");
+	printf("  -q <frames>   processing quantum of the engine (%u - %u, default %u)\n", AUDIO_MIN_QUANTUM, AUDIO_MAX_QUANTUM, AUDIO_DEFAULT_QUANTUM);
+	printf("  --faudio      measure the FAudio engine on the audio device instead of the offline engine\n");
+	printf("  --native      measure the native engine, mixed on this thread like the offline engine\n");
+}
+
+static double percentile(const std::vector<double> &p_sorted, double p_fraction)
+{
+	size_t idx = (size_t) (p_fraction * (p_sorted.size() - 1) + 0.5);
+	return p_sorted[idx];
+}
+
+static void measure(AudioContext *p_context, AudioEngine p_engine, AudioTrigger p_trigger, int p_count)
+{
+	size_t quantum_frames = audio_quantum_frames(p_context);
+	std::vector<float> quantum(quantum_frames * 2);
+	std::vector<double> latencies;
+	int missed = 0;
+
+	// the wave is played dry: with the reverb enabled the tail of the previous trigger would hide the onset of the next one
+	ReverbParameters reverb_params = audio_reverb_presets[0];
+	audio_effect_change(p_context, p_trigger == AudioTrigger_EffectChange, &reverb_params, AudioReverbField_All);
+
+	for (int idx = 0; idx < p_count; ++idx)
+	{
+		if (p_trigger == AudioTrigger_WavePlay)
+		{
+			audio_wave_play(p_context);
+		}
+		else
+		{
+			reverb_params = audio_reverb_presets[idx % audio_reverb_preset_count];
+			audio_effect_change(p_context, true, &reverb_params, AudioReverbField_All);
+		}
+
+		// pump the engine until the trigger was observed
+		auto start_time = std::chrono::steady_clock::now();
+		double latency = audio_trigger_latency(p_context, p_trigger);
+
+		while (latency < 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() < LATENCY_TIMEOUT)
+		{
+			if (p_engine != AudioEngine_FAudio)
+				audio_render(p_context, quantum.data(), quantum_frames);
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+			latency = audio_trigger_latency(p_context, p_trigger);
+		}
+
+		if (latency < 0.0)
+			++missed;
+		else
+			latencies.push_back(latency);
+	}
+
+	printf("%s: %d triggers, %d missed\n", (p_trigger == AudioTrigger_WavePlay) ? "audio_wave_play" : "audio_effect_change", p_count, missed);
+
+	if (latencies.empty())
+		return;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	printf("  min %10.1f us\n", latencies.front());
+	printf("  p50 %10.1f us\n", percentile(latencies, 0.50));
+	printf("  p90 %10.1f us\n", percentile(latencies, 0.90));
+	printf("  p99 %10.1f us\n", percentile(latencies, 0.99));
+	printf("  p99.9 %8.1f us\n", percentile(latencies, 0.999));
+	printf("  max %10.1f us\n", latencies.back());
+}
+
+int main(int argc, char **argv)
+{
+	int count = 2000;
+	int quantum = AUDIO_DEFAULT_QUANTUM;
+	AudioEngine engine = AudioEngine_Offline;
+
+	// parse the command line
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		if (strcmp(argv[idx], "-n") == 0 && idx + 1 < argc)
+			count = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-q") == 0 && idx + 1 < argc)
+			quantum = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "--faudio") == 0)
+			engine = AudioEngine_FAudio;
+		else if (strcmp(argv[idx], "--native") == 0)
+			engine = AudioEngine_Native;
+		else
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (count < 1 || quantum < (int) AUDIO_MIN_QUANTUM || quantum > (int) AUDIO_MAX_QUANTUM)
+	{
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	AudioContext *context = audio_create_context(engine, false, quantum);
+
+	if (context == nullptr)
+	{
+		printf("Error: unable to create the audio engine\n");
+		return -1;
+	}
+
+	// a quantum is only heard once it's completely mixed, on top of the trigger latency measured below
+	uint32_t quantum_frames = audio_quantum_frames(context);
+	printf("quantum: %u frames, %.2f ms of buffering\n", quantum_frames, quantum_frames * 1000.0 / AUDIO_MASTER_SAMPLERATE);
+
+	measure(context, engine, AudioTrigger_WavePlay, count);
+	measure(context, engine, AudioTrigger_EffectChange, count);
+
+	audio_destroy_context(context);
+
+	return 0;
+}
@@ -10,18 +10,27 @@
 #include <SDL.h>
 
 #include "main_gui.h"
+#include "native_ir_cache.h"
 
 const char *WINDOW_TITLE = "FAudio Reverb Demo";
+const char *IR_CACHE_FILENAME = "FAudioReverbDemo.ircache";
 
 int main(int, char**)
 {
     // Setup SDL
-    if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_TIMER) != 0)
+    if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_TIMER|SDL_INIT_AUDIO) != 0)
     {
         printf("Error: %s\n", SDL_GetError());
         return -1;
     }
 
+    // Impulse responses of the convolution mode, captured once and kept across sessions. The presets of both output
+    // layouts are captured here, so switching to the convolution mode or between presets never waits for a capture.
+    if (!native_ir_cache_open(IR_CACHE_FILENAME))
+        printf("Warning: unable to open %s, impulse responses will be captured every time\n", IR_CACHE_FILENAME);
+    else if (native_ir_cache_precompute(AUDIO_MASTER_SAMPLERATE, 2) + native_ir_cache_precompute(AUDIO_MASTER_SAMPLERATE, 6) > 0)
+        printf("Captured the preset impulse responses into %s\n", IR_CACHE_FILENAME);
+
     // Setup window
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -32,7 +41,7 @@ int main(int, char**)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
     SDL_DisplayMode current;
     SDL_GetCurrentDisplayMode(0, &current);
-    SDL_Window *window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 850, SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE);
+    SDL_Window *window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1000, 895, SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE);
     SDL_GLContext glcontext = SDL_GL_CreateContext(window);
     gl3wInit();
 
@@ -94,6 +103,7 @@ int main(int, char**)
     SDL_GL_DeleteContext(glcontext);
     SDL_DestroyWindow(window);
     SDL_Quit();
+    native_ir_cache_close();
 
     return 0;
 }
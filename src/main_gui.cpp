@@ -2,7 +2,11 @@
 #include "imgui/imgui.h"
 
 #include "audio_player.h"
+#include "audio_timing.h"
+#include "native_reverb.h"
 #include <math.h>
+#include <stdio.h>
+#include <SDL.h>
 
 int next_window_dims(int y_pos, int height)
 {
@@ -12,25 +16,139 @@ int next_window_dims(int y_pos, int height)
 	return y_pos + height;
 }
 
+// audio device for the engines that render on the caller's thread (see audio_render)
+static SDL_AudioDeviceID audio_device = 0;
+static unsigned int audio_device_channels = 2;
+static unsigned int audio_device_frames = 0;		// size of the device buffer SDL actually uses
+
+void audio_device_callback(void *p_userdata, Uint8 *p_stream, int p_len)
+{
+	AudioPlayer *player = (AudioPlayer *) p_userdata;
+	player->render((float *) p_stream, p_len / (sizeof(float) * audio_device_channels));
+}
+
+void audio_device_open(AudioPlayer *p_player, bool p_output_5p1)
+{
+	// the device buffer holds at least one quantum, rounded up to the power of two SDL wants
+	Uint16 samples = 64;
+	while (samples < p_player->quantum_frames() && samples < 32768)
+		samples *= 2;
+
+	SDL_AudioSpec desired;
+	SDL_zero(desired);
+	desired.freq = AUDIO_MASTER_SAMPLERATE;
+	desired.format = AUDIO_F32SYS;
+	desired.channels = p_output_5p1 ? 6 : 2;
+	desired.samples = samples;
+	desired.callback = audio_device_callback;
+	desired.userdata = p_player;
+
+	// no allowed changes: SDL converts to whatever the device wants
+	SDL_AudioSpec obtained;
+	audio_device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+	audio_device_channels = desired.channels;
+	audio_device_frames = obtained.samples;
+
+	if (audio_device == 0)
+	{
+		printf("Error: %s\n", SDL_GetError());
+		return;
+	}
+
+	SDL_PauseAudioDevice(audio_device, 0);
+}
+
+void audio_device_close()
+{
+	if (audio_device == 0)
+		return;
+
+	SDL_CloseAudioDevice(audio_device);
+	audio_device = 0;
+}
+
+void timing_histogram(const char *p_label, const float *p_values, size_t p_count, float p_scale, const char *p_unit)
+{
+	float last_value = 0.0f;
+	float max_value = 0.0f;
+	float sum = 0.0f;
+
+	for (size_t idx = 0; idx < p_count; ++idx)
+	{
+		max_value = fmaxf(max_value, p_values[idx]);
+		sum += p_values[idx];
+	}
+
+	if (p_count > 0)
+		last_value = p_values[p_count - 1];
+
+	ImGui::Text("%s", p_label);
+
+	char overlay[96];
+	if (p_count > 0)
+		snprintf(overlay, sizeof(overlay), "last %.1f  avg %.1f  max %.1f %s", last_value * p_scale, sum / p_count * p_scale, max_value * p_scale, p_unit);
+	else
+		snprintf(overlay, sizeof(overlay), "not available for this engine");
+
+	ImGui::PushID(p_label);
+	ImGui::PushItemWidth(-1.0f);
+	ImGui::PlotHistogram("", p_values, (int) p_count, 0, overlay, 0.0f, max_value, ImVec2(0, 120));
+	ImGui::PopItemWidth();
+	ImGui::PopID();
+}
+
+// average of a timing history for the text readouts, negative when there are no values
+float timing_average(const float *p_values, size_t p_count)
+{
+	if (p_count == 0)
+		return -1.0f;
+
+	float sum = 0.0f;
+	for (size_t idx = 0; idx < p_count; ++idx)
+		sum += p_values[idx];
+
+	return sum / p_count;
+}
+
 void main_gui()
 {
 	bool update_engine = false;
 	bool update_wave = false;
 	bool play_wave = false;
 	bool update_effect = false;
+	bool morph_effect = false;
+	bool update_mode = false;
+	bool update_tail = false;
+	bool record_automation = false;
+	bool replay_automation = false;
+
+	static AudioPlayer	player;
+
+	// frame time of the gui loop, as measured by imgui between two frames
+	static AudioTimingHistory frame_times;
+	frame_times.push(ImGui::GetIO().DeltaTime * 1000000.0f);
 
 	// gui
-	int window_y = next_window_dims(0, 50);
+	int window_y = next_window_dims(0, 75);
 	ImGui::Begin("Output Audio Engine");
 
 		static int audio_engine = (int)AudioEngine_FAudio;
 		update_engine |= ImGui::RadioButton("FAudio", &audio_engine, (int)AudioEngine_FAudio); ImGui::SameLine();
+		update_engine |= ImGui::RadioButton("Offline", &audio_engine, (int)AudioEngine_Offline); ImGui::SameLine();
+		update_engine |= ImGui::RadioButton("Native", &audio_engine, (int)AudioEngine_Native); ImGui::SameLine();
 		#ifdef HAVE_XAUDIO2 
 		update_engine |= ImGui::RadioButton("XAudio2", &audio_engine, (int)AudioEngine_XAudio2); ImGui::SameLine();
 		#endif
 
 		static bool output_5p1 = false;
-		update_engine |= ImGui::Checkbox("5.1 channel output", &output_5p1);
+		update_engine |= ImGui::Checkbox("5.1 channel output", &output_5p1); ImGui::SameLine();
+		ImGui::Text("Memory in use: %.1f KB", player.bytes_in_use() / 1024.0f);
+
+		// frames per processing pass: small for live monitoring, large for throughput. FAudio and XAudio2 round to 441 or 940.
+		static const char *quantum_names[] = { "64", "128", "256", "441 (10 ms)", "1024", "2048", "4096" };
+		static const uint32_t quantum_sizes[] = { 64, 128, 256, AUDIO_DEFAULT_QUANTUM, 1024, 2048, 4096 };
+		static int quantum_index = 3;
+		update_engine |= ImGui::Combo("Quantum (frames)", &quantum_index, quantum_names, sizeof(quantum_names) / sizeof(quantum_names[0]));
 
 	ImGui::End();
 
@@ -39,21 +157,26 @@ void main_gui()
 
 		static int wave_index = (int)AudioWave_SnareDrum01;
 		static bool wave_stereo = false;
+		static bool wave_tail_aware = false;
 
 		update_wave |= ImGui::RadioButton("Snare Drum (Forte)", &wave_index, (int)AudioWave_SnareDrum01); ImGui::SameLine();
 		update_wave |= ImGui::RadioButton("Snare Drum (Fortissimo)", &wave_index, (int)AudioWave_SnareDrum02); ImGui::SameLine();
 		update_wave |= ImGui::RadioButton("Snare Drum (Mezzo-Forte)", &wave_index, (int)AudioWave_SnareDrum03); 
 
 		play_wave = ImGui::Button("Play"); ImGui::SameLine();
-		update_wave |= ImGui::Checkbox("Stereo", &wave_stereo);
+		update_wave |= ImGui::Checkbox("Stereo", &wave_stereo); ImGui::SameLine();
+		update_tail |= ImGui::Checkbox("Tail-aware (stop once the reverb decayed)", &wave_tail_aware);
 		
 	ImGui::End();
 
-	window_y = next_window_dims(window_y, 80);
+	window_y = next_window_dims(window_y, 125);
 	ImGui::Begin("Reverb effect");
 		
 		static bool effect_enabled = false;
-		update_effect |= ImGui::Checkbox("Enabled", &effect_enabled);
+		update_effect |= ImGui::Checkbox("Enabled", &effect_enabled); ImGui::SameLine();
+
+		static bool effect_convolution = false;
+		update_mode |= ImGui::Checkbox("Convolution (native engine)", &effect_convolution);
 		
 		static int preset_index = -1;
 		static ReverbParameters reverb_params = {
@@ -77,16 +200,60 @@ void main_gui()
 			100.0f,
 		};
 
+		// a preset switch crossfades on the audio thread when a morph time is set
+		static float morph_seconds = 0.0f;
+
 		if (ImGui::Combo("Preset", &preset_index, audio_reverb_preset_names, audio_reverb_preset_count)) {
 			memcpy(&reverb_params, &audio_reverb_presets[preset_index], sizeof(ReverbParameters));
-			update_effect = true;
+			morph_effect = morph_seconds > 0.0f;
+			update_effect = !morph_effect;
+		}
+
+		ImGui::SliderFloat("Preset morph (s)", &morph_seconds, 0.0f, 5.0f);
+
+		// average cost of the reverb per quantum, the values of a mode are kept while the other one runs
+		float mode_times[AUDIO_TIMING_HISTORY];
+		char mode_text[AudioEffectMode_Count][32];
+
+		for (int mode = 0; mode < AudioEffectMode_Count; ++mode)
+		{
+			float average = timing_average(mode_times, player.effect_mode_times((AudioEffectMode) mode, mode_times, AUDIO_TIMING_HISTORY));
+
+			if (average >= 0.0f)
+				snprintf(mode_text[mode], sizeof(mode_text[mode]), "%.1f us", average);
+			else
+				snprintf(mode_text[mode], sizeof(mode_text[mode]), "-");
 		}
 
+		ImGui::Text("Reverb per quantum: algorithmic %s, convolution %s", mode_text[AudioEffectMode_Algorithmic], mode_text[AudioEffectMode_Convolution]);
+
 	ImGui::End();
 
-	window_y = next_window_dims(window_y, 630);
+	window_y = next_window_dims(window_y, 655);
 	ImGui::Begin("FAudio Tune Detail");
 
+		// every change of the effect while recording, timestamped from the start of the voice, for reproducible runs
+		static AudioAutomation automation;
+		static const char *automation_status = "";
+
+		if (!automation.recording())
+			record_automation = ImGui::Button("Record");
+		else if (ImGui::Button("Stop"))
+			automation.stop();
+
+		ImGui::SameLine();
+		replay_automation = ImGui::Button("Replay"); ImGui::SameLine();
+
+		if (ImGui::Button("Save"))
+			automation_status = automation.save("automation.txt") ? "saved automation.txt" : "unable to save automation.txt";
+		ImGui::SameLine();
+
+		if (ImGui::Button("Load"))
+			automation_status = automation.load("automation.txt") ? "loaded automation.txt" : "unable to load automation.txt";
+		ImGui::SameLine();
+
+		ImGui::Text("%d changes, %.2f s %s", (int) automation.count(), (double) automation.length() / AUDIO_MASTER_SAMPLERATE, automation_status);
+
 		int ReverbDelay = reverb_params.ReverbDelay;
 		int PositionLeft = reverb_params.PositionLeft;
 		int PositionRight = reverb_params.PositionRight;
@@ -142,27 +309,116 @@ void main_gui()
 
 	ImGui::End();
 
+	ImGui::SetNextWindowPos(ImVec2(640, 0));
+	ImGui::SetNextWindowSize(ImVec2(360, static_cast<float>(window_y)));
+	ImGui::Begin("Timing");
 
-	// audio control
-	static AudioPlayer	player;
+		float times[AUDIO_TIMING_HISTORY];
+		size_t count;
+
+		count = frame_times.copy(times, AUDIO_TIMING_HISTORY);
+		timing_histogram("GUI frame time", times, count, 0.001f, "ms");
+
+		count = player.effect_times(times, AUDIO_TIMING_HISTORY);
+		timing_histogram("AudioPlayer::change_effect", times, count, 1.0f, "us");
+		ImGui::Text("Effect updates: %llu sent, %llu unchanged", (unsigned long long) player.effect_updates_sent(),
+					(unsigned long long) player.effect_updates_suppressed());
 
+		count = player.quantum_times(times, AUDIO_TIMING_HISTORY);
+		timing_histogram("Audio engine per quantum", times, count, 1.0f, "us");
+
+		// output latency: the quantum being mixed plus the device buffer behind it. The native engine plays through our own
+		//	SDL device, FAudio and XAudio2 open theirs with a buffer of one quantum.
+		uint32_t quantum_frames = player.quantum_frames();
+		uint32_t device_frames = (audio_device != 0) ? audio_device_frames : quantum_frames;
+		float quantum_average = timing_average(times, count);
+
+		ImGui::Text("Quantum: %u frames, output latency %.1f ms", quantum_frames,
+			(quantum_frames + device_frames) * 1000.0f / AUDIO_MASTER_SAMPLERATE);
+
+		if (quantum_average >= 0.0f && quantum_frames > 0)
+			ImGui::Text("Audio engine CPU per sample: %.1f ns", quantum_average * 1000.0f / quantum_frames);
+		else
+			ImGui::Text("Audio engine CPU per sample: -");
+
+		if (audio_engine == AudioEngine_Native)
+			ImGui::Text("Native reverb kernels: %s", native_reverb_kernels_name());
+
+	ImGui::End();
+
+
+	// audio control
 	if (update_engine)
 	{
+		audio_device_close();
 		player.shutdown();
-		player.setup((AudioEngine)audio_engine, output_5p1);
+		player.setup((AudioEngine)audio_engine, output_5p1, quantum_sizes[quantum_index]);
+
+		// the offline and native engines only mix when asked for output, the device callback asks for it
+		if (audio_engine == AudioEngine_Offline || audio_engine == AudioEngine_Native)
+			audio_device_open(&player, output_5p1);
 	}
 
+	// keep the device callback out of the engine while it's being changed
+	if (audio_device != 0)
+		SDL_LockAudioDevice(audio_device);
+
 	if (update_wave | update_engine)
 	{
 		player.load_wave_sample((AudioSampleWave) wave_index, wave_stereo);
 	}
 
+	if (update_engine || update_tail)
+	{
+		// XAudio2 keeps the fixed tail
+		if (!player.set_tail_mode(wave_tail_aware ? AudioTailMode_Decay : AudioTailMode_Fixed))
+			wave_tail_aware = false;
+	}
+
 	if (play_wave) {
 		player.play_wave();
 	}
 
+	// the recording starts with the voice and the state of the effect at that moment
+	if (record_automation) {
+		automation.start(effect_enabled, reverb_params);
+		player.play_wave();
+		automation_status = "";
+	}
+
+	if (replay_automation && !automation.recording()) {
+		if (!player.play_automation(automation))
+			automation_status = "no replay on this engine or in the convolution mode";
+	}
+
+	if (audio_device != 0)
+		SDL_UnlockAudioDevice(audio_device);
+
+	// the effect changes are posted to the mixer, which picks them up at its next quantum: they never wait on the
+	//	device callback. All changes of the frame go out as one batch, the mixer never runs with half of them.
+	player.begin_changes();
+
 	if ((update_engine || update_effect))
 	{
 		player.change_effect(effect_enabled, &reverb_params);
 	}
+	else if (morph_effect)
+	{
+		player.morph_effect(&reverb_params, morph_seconds);
+	}
+
+	// a morph is recorded as a jump to its target
+	if (update_effect || morph_effect)
+	{
+		automation.record(effect_enabled, reverb_params);
+	}
+
+	if (update_engine || update_mode)
+	{
+		// only the native engine can convolve
+		if (!player.set_effect_mode(effect_convolution ? AudioEffectMode_Convolution : AudioEffectMode_Algorithmic))
+			effect_convolution = false;
+	}
+
+	player.commit_changes();
 }
\ No newline at end of file
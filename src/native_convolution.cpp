@@ -0,0 +1,506 @@
+#include "native_convolution.h"
+#include "native_reverb_kernels.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// real FFT of size 2 * half, computed as a complex FFT of size half on split arrays
+struct NativeFft
+{
+	uint32_t			  half;
+	std::vector<uint32_t> bitrev;
+	std::vector<float>	  twiddle_re;		// e^(-2 pi i k / half), k < half / 2
+	std::vector<float>	  twiddle_im;
+	std::vector<float>	  post_re;			// e^(-2 pi i k / (2 * half)), k <= half
+	std::vector<float>	  post_im;
+	std::vector<float>	  work_re;
+	std::vector<float>	  work_im;
+};
+
+// one group of equally sized partitions, covering the response from start to start + partitions * block
+struct NativeConvolutionStage
+{
+	uint32_t		   block;
+	uint32_t		   start;
+	uint32_t		   partitions;
+	bool			   spread;			// accumulate over the frames of the next partition, only valid when start == 2 * block
+
+	uint32_t		   bins;			// block + 1 complex values per spectrum, stored as bins re followed by bins im
+	NativeFft		   fft;
+
+	std::vector<float> spectra;			// [channel][partition] spectra of the response
+	std::vector<float> history;			// [partition] spectra of the past input windows, a ring ending at newest
+	uint32_t		   newest;
+
+	std::vector<float> window;			// the previous and the current input block
+	uint32_t		   fill;			// frames of the current block received so far
+
+	std::vector<float> accum;			// [channel] spectrum of the next output block
+	uint32_t		   done;			// partitions accumulated into accum
+
+	std::vector<float> output;			// [channel] output block being played
+	std::vector<float> time;			// 2 * block scratch
+};
+
+struct NativeConvolution
+{
+	unsigned int			  channels;
+	uint32_t				  max_frames;
+	const NativeReverbKernels *kernels;
+
+	std::vector<unsigned int> active;		// output channel of every convolved channel
+
+	std::vector<float>		  head;			// [channel][NATIVE_CONVOLUTION_HEAD] first frames of the response
+	std::vector<float>		  head_input;	// NATIVE_CONVOLUTION_HEAD - 1 frames of history followed by the current block
+
+	NativeConvolutionStage	  stages[2];
+
+	std::vector<float>		  planar;		// [channel][max_frames] output before interleaving
+};
+
+// fft
+static void native_fft_init(NativeFft &p_fft, uint32_t p_half)
+{
+	p_fft.half = p_half;
+	p_fft.bitrev.resize(p_half);
+	p_fft.twiddle_re.resize(p_half / 2);
+	p_fft.twiddle_im.resize(p_half / 2);
+	p_fft.post_re.resize(p_half + 1);
+	p_fft.post_im.resize(p_half + 1);
+	p_fft.work_re.resize(p_half);
+	p_fft.work_im.resize(p_half);
+
+	uint32_t bits = 0;
+	while ((1u << bits) < p_half)
+		++bits;
+
+	for (uint32_t idx = 0; idx < p_half; ++idx)
+	{
+		uint32_t reversed = 0;
+		for (uint32_t bit = 0; bit < bits; ++bit)
+			reversed |= ((idx >> bit) & 1) << (bits - 1 - bit);
+		p_fft.bitrev[idx] = reversed;
+	}
+
+	for (uint32_t k = 0; k < p_half / 2; ++k)
+	{
+		double angle = -2.0 * 3.14159265358979323846 * k / p_half;
+		p_fft.twiddle_re[k] = (float) cos(angle);
+		p_fft.twiddle_im[k] = (float) sin(angle);
+	}
+
+	for (uint32_t k = 0; k <= p_half; ++k)
+	{
+		double angle = -3.14159265358979323846 * k / p_half;
+		p_fft.post_re[k] = (float) cos(angle);
+		p_fft.post_im[k] = (float) sin(angle);
+	}
+}
+
+// in place, unscaled in both directions
+static void native_fft_complex(NativeFft &p_fft, float *p_re, float *p_im, bool p_inverse)
+{
+	uint32_t size = p_fft.half;
+
+	for (uint32_t idx = 0; idx < size; ++idx)
+	{
+		uint32_t other = p_fft.bitrev[idx];
+		if (idx < other)
+		{
+			float re = p_re[idx]; p_re[idx] = p_re[other]; p_re[other] = re;
+			float im = p_im[idx]; p_im[idx] = p_im[other]; p_im[other] = im;
+		}
+	}
+
+	float sign = p_inverse ? -1.0f : 1.0f;
+
+	for (uint32_t length = 2; length <= size; length <<= 1)
+	{
+		uint32_t half_length = length / 2;
+		uint32_t step = size / length;
+
+		for (uint32_t start = 0; start < size; start += length)
+		{
+			for (uint32_t k = 0; k < half_length; ++k)
+			{
+				float w_re = p_fft.twiddle_re[k * step];
+				float w_im = sign * p_fft.twiddle_im[k * step];
+
+				uint32_t a = start + k;
+				uint32_t b = a + half_length;
+
+				float t_re = p_re[b] * w_re - p_im[b] * w_im;
+				float t_im = p_re[b] * w_im + p_im[b] * w_re;
+
+				p_re[b] = p_re[a] - t_re;
+				p_im[b] = p_im[a] - t_im;
+				p_re[a] += t_re;
+				p_im[a] += t_im;
+			}
+		}
+	}
+}
+
+// 2 * half real samples into half + 1 bins
+static void native_fft_forward(NativeFft &p_fft, const float *p_input, float *p_re, float *p_im)
+{
+	uint32_t half = p_fft.half;
+	float *z_re = p_fft.work_re.data();
+	float *z_im = p_fft.work_im.data();
+
+	for (uint32_t idx = 0; idx < half; ++idx)
+	{
+		z_re[idx] = p_input[2 * idx];
+		z_im[idx] = p_input[2 * idx + 1];
+	}
+
+	native_fft_complex(p_fft, z_re, z_im, false);
+
+	// split into the spectra of the even and odd samples and combine them
+	for (uint32_t k = 0; k <= half; ++k)
+	{
+		uint32_t a = (k == half) ? 0 : k;
+		uint32_t b = (k == 0) ? 0 : half - k;
+
+		float even_re = 0.5f * (z_re[a] + z_re[b]);
+		float even_im = 0.5f * (z_im[a] - z_im[b]);
+		float odd_re = 0.5f * (z_im[a] + z_im[b]);
+		float odd_im = -0.5f * (z_re[a] - z_re[b]);
+
+		p_re[k] = even_re + p_fft.post_re[k] * odd_re - p_fft.post_im[k] * odd_im;
+		p_im[k] = even_im + p_fft.post_re[k] * odd_im + p_fft.post_im[k] * odd_re;
+	}
+}
+
+// half + 1 bins into 2 * half real samples, scaled by half
+static void native_fft_inverse(NativeFft &p_fft, const float *p_re, const float *p_im, float *p_output)
+{
+	uint32_t half = p_fft.half;
+	float *z_re = p_fft.work_re.data();
+	float *z_im = p_fft.work_im.data();
+
+	for (uint32_t k = 0; k < half; ++k)
+	{
+		float even_re = 0.5f * (p_re[k] + p_re[half - k]);
+		float even_im = 0.5f * (p_im[k] - p_im[half - k]);
+		float diff_re = 0.5f * (p_re[k] - p_re[half - k]);
+		float diff_im = 0.5f * (p_im[k] + p_im[half - k]);
+
+		// odd = diff * conj(post)
+		float odd_re = diff_re * p_fft.post_re[k] + diff_im * p_fft.post_im[k];
+		float odd_im = diff_im * p_fft.post_re[k] - diff_re * p_fft.post_im[k];
+
+		z_re[k] = even_re - odd_im;
+		z_im[k] = even_im + odd_re;
+	}
+
+	native_fft_complex(p_fft, z_re, z_im, true);
+
+	for (uint32_t idx = 0; idx < half; ++idx)
+	{
+		p_output[2 * idx] = z_re[idx];
+		p_output[2 * idx + 1] = z_im[idx];
+	}
+}
+
+// stages
+static void native_stage_init(NativeConvolutionStage &p_stage, uint32_t p_block, uint32_t p_start, uint32_t p_end, bool p_spread,
+							  const float *p_response, uint32_t p_frames, unsigned int p_channels, const std::vector<unsigned int> &p_active)
+{
+	uint32_t end = (p_end < p_frames) ? p_end : p_frames;
+
+	p_stage.block = p_block;
+	p_stage.start = p_start;
+	p_stage.partitions = (end > p_start) ? (end - p_start + p_block - 1) / p_block : 0;
+	p_stage.spread = p_spread;
+	p_stage.bins = p_block + 1;
+	p_stage.newest = 0;
+	p_stage.fill = 0;
+	p_stage.done = 0;
+
+	if (p_stage.partitions == 0)
+		return;
+
+	native_fft_init(p_stage.fft, p_block);
+
+	size_t spectrum = 2 * p_stage.bins;
+	size_t channels = p_active.size();
+
+	p_stage.spectra.resize(channels * p_stage.partitions * spectrum);
+	p_stage.history.resize(p_stage.partitions * spectrum);
+	p_stage.window.resize(2 * p_block);
+	p_stage.accum.resize(channels * spectrum);
+	p_stage.output.resize(channels * p_block);
+	p_stage.time.resize(2 * p_block);
+
+	// the inverse transform is scaled by the block size, undo that once here
+	float scale = 1.0f / p_block;
+
+	for (size_t ch = 0; ch < channels; ++ch)
+	{
+		for (uint32_t partition = 0; partition < p_stage.partitions; ++partition)
+		{
+			uint32_t first = p_start + partition * p_block;
+
+			for (uint32_t idx = 0; idx < 2 * p_block; ++idx)
+			{
+				uint32_t frame = first + idx;
+				p_stage.time[idx] = (idx < p_block && frame < end) ? scale * p_response[frame * p_channels + p_active[ch]] : 0.0f;
+			}
+
+			float *spectrum_re = p_stage.spectra.data() + (ch * p_stage.partitions + partition) * spectrum;
+			native_fft_forward(p_stage.fft, p_stage.time.data(), spectrum_re, spectrum_re + p_stage.bins);
+		}
+	}
+}
+
+static void native_stage_reset(NativeConvolutionStage &p_stage)
+{
+	p_stage.newest = 0;
+	p_stage.fill = 0;
+	p_stage.done = 0;
+
+	memset(p_stage.history.data(), 0, sizeof(float) * p_stage.history.size());
+	memset(p_stage.window.data(), 0, sizeof(float) * p_stage.window.size());
+	memset(p_stage.accum.data(), 0, sizeof(float) * p_stage.accum.size());
+	memset(p_stage.output.data(), 0, sizeof(float) * p_stage.output.size());
+}
+
+static void native_stage_accumulate(const NativeReverbKernels *p_kernels, NativeConvolutionStage &p_stage, size_t p_channels, uint32_t p_target)
+{
+	uint32_t bins = p_stage.bins;
+	size_t spectrum = 2 * bins;
+
+	for (; p_stage.done < p_target; ++p_stage.done)
+	{
+		uint32_t slot = (p_stage.newest + p_stage.partitions - p_stage.done) % p_stage.partitions;
+		const float *input = p_stage.history.data() + slot * spectrum;
+
+		for (size_t ch = 0; ch < p_channels; ++ch)
+		{
+			const float *response = p_stage.spectra.data() + (ch * p_stage.partitions + p_stage.done) * spectrum;
+			float *accum = p_stage.accum.data() + ch * spectrum;
+
+			p_kernels->cmac(accum, accum + bins, input, input + bins, response, response + bins, bins);
+		}
+	}
+}
+
+static void native_stage_finish(NativeConvolutionStage &p_stage, size_t p_channels)
+{
+	size_t spectrum = 2 * p_stage.bins;
+
+	for (size_t ch = 0; ch < p_channels; ++ch)
+	{
+		float *accum = p_stage.accum.data() + ch * spectrum;
+		native_fft_inverse(p_stage.fft, accum, accum + p_stage.bins, p_stage.time.data());
+
+		// overlap-save: only the second half of the window is free of wrap-around
+		memcpy(p_stage.output.data() + ch * p_stage.block, p_stage.time.data() + p_stage.block, sizeof(float) * p_stage.block);
+	}
+}
+
+static void native_stage_block_done(const NativeReverbKernels *p_kernels, NativeConvolutionStage &p_stage, size_t p_channels)
+{
+	uint32_t block = p_stage.block;
+	size_t spectrum = 2 * p_stage.bins;
+
+	// a spread stage computes the output of the block that starts now from the blocks up to the previous one
+	if (p_stage.spread)
+	{
+		native_stage_accumulate(p_kernels, p_stage, p_channels, p_stage.partitions);
+		native_stage_finish(p_stage, p_channels);
+	}
+
+	// transform the completed window into the input history
+	p_stage.newest = (p_stage.newest + 1) % p_stage.partitions;
+	float *input = p_stage.history.data() + p_stage.newest * spectrum;
+	native_fft_forward(p_stage.fft, p_stage.window.data(), input, input + p_stage.bins);
+
+	memcpy(p_stage.window.data(), p_stage.window.data() + block, sizeof(float) * block);
+	p_stage.fill = 0;
+
+	memset(p_stage.accum.data(), 0, sizeof(float) * p_stage.accum.size());
+	p_stage.done = 0;
+
+	// the other stage needs the block that was just completed for the output that starts now
+	if (!p_stage.spread)
+	{
+		native_stage_accumulate(p_kernels, p_stage, p_channels, p_stage.partitions);
+		native_stage_finish(p_stage, p_channels);
+	}
+}
+
+static void native_stage_process(NativeConvolution *p_convolution, NativeConvolutionStage &p_stage, const float *p_input, uint32_t p_frames)
+{
+	const NativeReverbKernels *kernels = p_convolution->kernels;
+	size_t channels = p_convolution->active.size();
+	uint32_t block = p_stage.block;
+	uint32_t done = 0;
+
+	while (done < p_frames)
+	{
+		uint32_t count = block - p_stage.fill;
+		if (count > p_frames - done)
+			count = p_frames - done;
+
+		memcpy(p_stage.window.data() + block + p_stage.fill, p_input + done, sizeof(float) * count);
+
+		for (size_t ch = 0; ch < channels; ++ch)
+		{
+			float *planar = p_convolution->planar.data() + ch * p_convolution->max_frames;
+			kernels->mac(planar + done, p_stage.output.data() + ch * block + p_stage.fill, count, 1.0f);
+		}
+
+		p_stage.fill += count;
+		done += count;
+
+		if (p_stage.spread)
+		{
+			native_stage_accumulate(kernels, p_stage, channels, (uint32_t) ((uint64_t) p_stage.partitions * p_stage.fill / block));
+		}
+
+		if (p_stage.fill == block)
+		{
+			native_stage_block_done(kernels, p_stage, channels);
+		}
+	}
+}
+
+static size_t native_stage_bytes_in_use(const NativeConvolutionStage &p_stage)
+{
+	size_t result = 0;
+
+	result += (p_stage.fft.bitrev.capacity()) * sizeof(uint32_t);
+	result += (p_stage.fft.twiddle_re.capacity() + p_stage.fft.twiddle_im.capacity()) * sizeof(float);
+	result += (p_stage.fft.post_re.capacity() + p_stage.fft.post_im.capacity()) * sizeof(float);
+	result += (p_stage.fft.work_re.capacity() + p_stage.fft.work_im.capacity()) * sizeof(float);
+	result += p_stage.spectra.capacity() * sizeof(float);
+	result += p_stage.history.capacity() * sizeof(float);
+	result += p_stage.window.capacity() * sizeof(float);
+	result += p_stage.accum.capacity() * sizeof(float);
+	result += p_stage.output.capacity() * sizeof(float);
+	result += p_stage.time.capacity() * sizeof(float);
+
+	return result;
+}
+
+// interface
+NativeConvolution *native_convolution_create(const float *p_response, uint32_t p_frames, unsigned int p_channels, uint32_t p_max_frames)
+{
+	NativeConvolution *result = new NativeConvolution();
+	result->channels = p_channels;
+	result->max_frames = p_max_frames;
+	result->kernels = native_reverb_kernels();
+
+	for (unsigned int ch = 0; ch < p_channels; ++ch)
+	{
+		bool silent = true;
+		for (uint32_t frame = 0; frame < p_frames && silent; ++frame)
+			silent = p_response[frame * p_channels + ch] == 0.0f;
+
+		if (!silent)
+			result->active.push_back(ch);
+	}
+
+	size_t channels = result->active.size();
+
+	result->head.resize(channels * NATIVE_CONVOLUTION_HEAD);
+	for (size_t ch = 0; ch < channels; ++ch)
+	{
+		for (uint32_t frame = 0; frame < NATIVE_CONVOLUTION_HEAD && frame < p_frames; ++frame)
+			result->head[ch * NATIVE_CONVOLUTION_HEAD + frame] = p_response[frame * p_channels + result->active[ch]];
+	}
+
+	result->head_input.resize(NATIVE_CONVOLUTION_HEAD - 1 + p_max_frames);
+
+	native_stage_init(result->stages[0], NATIVE_CONVOLUTION_HEAD, NATIVE_CONVOLUTION_HEAD, NATIVE_CONVOLUTION_SPLIT, false,
+					  p_response, p_frames, p_channels, result->active);
+	native_stage_init(result->stages[1], NATIVE_CONVOLUTION_LONG, NATIVE_CONVOLUTION_SPLIT, p_frames, true,
+					  p_response, p_frames, p_channels, result->active);
+
+	result->planar.resize(channels * p_max_frames);
+
+	native_convolution_reset(result);
+
+	return result;
+}
+
+void native_convolution_destroy(NativeConvolution *p_convolution)
+{
+	delete p_convolution;
+}
+
+void native_convolution_reset(NativeConvolution *p_convolution)
+{
+	memset(p_convolution->head_input.data(), 0, sizeof(float) * p_convolution->head_input.size());
+
+	for (auto &stage : p_convolution->stages)
+		native_stage_reset(stage);
+}
+
+void native_convolution_process(NativeConvolution *p_convolution, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	const NativeReverbKernels *kernels = p_convolution->kernels;
+	size_t channels = p_convolution->active.size();
+	uint32_t max_frames = p_convolution->max_frames;
+	const uint32_t history = NATIVE_CONVOLUTION_HEAD - 1;
+
+	if (p_frames > max_frames)
+		p_frames = max_frames;
+
+	// head: direct convolution against the input history
+	float *head_input = p_convolution->head_input.data();
+	memcpy(head_input + history, p_input, sizeof(float) * p_frames);
+	memset(p_convolution->planar.data(), 0, sizeof(float) * p_convolution->planar.size());
+
+	for (size_t ch = 0; ch < channels; ++ch)
+	{
+		float *planar = p_convolution->planar.data() + ch * max_frames;
+		const float *head = p_convolution->head.data() + ch * NATIVE_CONVOLUTION_HEAD;
+
+		for (uint32_t tap = 0; tap < NATIVE_CONVOLUTION_HEAD; ++tap)
+		{
+			if (head[tap] != 0.0f)
+				kernels->mac(planar, head_input + history - tap, p_frames, head[tap]);
+		}
+	}
+
+	memmove(head_input, head_input + p_frames, sizeof(float) * history);
+
+	// the partitioned rest of the response
+	for (auto &stage : p_convolution->stages)
+	{
+		if (stage.partitions > 0)
+			native_stage_process(p_convolution, stage, p_input, p_frames);
+	}
+
+	// interleave, silent channels stay zero
+	unsigned int out_channels = p_convolution->channels;
+	memset(p_output, 0, sizeof(float) * p_frames * out_channels);
+
+	for (size_t ch = 0; ch < channels; ++ch)
+	{
+		const float *planar = p_convolution->planar.data() + ch * max_frames;
+		unsigned int out_ch = p_convolution->active[ch];
+
+		for (uint32_t frame = 0; frame < p_frames; ++frame)
+			p_output[frame * out_channels + out_ch] = planar[frame];
+	}
+}
+
+size_t native_convolution_bytes_in_use(const NativeConvolution *p_convolution)
+{
+	size_t result = sizeof(NativeConvolution);
+
+	result += p_convolution->active.capacity() * sizeof(unsigned int);
+	result += p_convolution->head.capacity() * sizeof(float);
+	result += p_convolution->head_input.capacity() * sizeof(float);
+	result += p_convolution->planar.capacity() * sizeof(float);
+
+	for (auto &stage : p_convolution->stages)
+		result += native_stage_bytes_in_use(stage);
+
+	return result;
+}
@@ -0,0 +1,33 @@
+#ifndef FAUDIOFILTERDEMO_NATIVE_CONVOLUTION_H
+#define FAUDIOFILTERDEMO_NATIVE_CONVOLUTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// zero latency convolution of a mono input with a multichannel impulse response, non-uniformly partitioned:
+//	- the first NATIVE_CONVOLUTION_HEAD frames of the response are applied directly in the time domain
+//	- up to NATIVE_CONVOLUTION_SPLIT frames, uniform FFT partitions of NATIVE_CONVOLUTION_HEAD frames
+//	- the rest in FFT partitions of NATIVE_CONVOLUTION_LONG frames. Their result is only needed one partition later, so
+//	  the spectral multiply-accumulate is spread evenly over the frames of a partition instead of running all at once.
+//	The cost per frame only depends on the response length, not on its content, and has no large spikes.
+
+const uint32_t NATIVE_CONVOLUTION_HEAD = 128;
+const uint32_t NATIVE_CONVOLUTION_LONG = 4096;
+const uint32_t NATIVE_CONVOLUTION_SPLIT = 2 * NATIVE_CONVOLUTION_LONG;
+
+struct NativeConvolution;
+
+// p_response holds p_frames interleaved frames of p_channels. Channels that are silent in the whole response are skipped
+//	during processing and only written as zeros. p_max_frames is the largest block native_convolution_process will get.
+NativeConvolution *native_convolution_create(const float *p_response, uint32_t p_frames, unsigned int p_channels, uint32_t p_max_frames);
+void native_convolution_destroy(NativeConvolution *p_convolution);
+
+// clears the input history
+void native_convolution_reset(NativeConvolution *p_convolution);
+
+// convolves p_frames frames of mono p_input, p_output (p_channels interleaved) is overwritten
+void native_convolution_process(NativeConvolution *p_convolution, const float *p_input, float *p_output, uint32_t p_frames);
+
+size_t native_convolution_bytes_in_use(const NativeConvolution *p_convolution);
+
+#endif // FAUDIOFILTERDEMO_NATIVE_CONVOLUTION_H
@@ -0,0 +1,493 @@
+#include "native_ir_cache.h"
+#include "native_reverb.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char NATIVE_IR_CACHE_MAGIC[8] = { 'F', 'A', 'R', 'V', 'I', 'R', 'C', '\0' };
+const uint32_t NATIVE_IR_CACHE_BYTE_ORDER = 0x01020304;
+const uint32_t NATIVE_IR_CACHE_RECORD = 0x43524952;		// starts every record
+
+#pragma pack(push, 1)
+
+struct NativeIrCacheHeader
+{
+	char	 magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+};
+
+// followed by frames * channels floats
+struct NativeIrCacheRecord
+{
+	uint32_t		 magic;
+	uint32_t		 sample_rate;
+	uint32_t		 channels;
+	uint32_t		 frames;
+	uint64_t		 hash;
+	ReverbParameters params;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(NativeIrCacheHeader) % sizeof(float) == 0 && sizeof(NativeIrCacheRecord) % sizeof(float) == 0,
+			  "the responses in the mapped file have to stay float aligned");
+
+struct NativeFileMapping
+{
+	const uint8_t *data;
+	size_t		   size;
+};
+
+// a response that isn't written to the file
+struct NativeIrCacheEntry
+{
+	NativeIrCacheRecord record;
+	std::vector<float>	response;
+};
+
+struct NativeIrCache
+{
+	std::string								   filename;
+	NativeFileMapping						   mapping;
+	std::unordered_multimap<uint64_t, size_t> index;		// hash -> offset of the record in the mapping
+
+	std::list<NativeIrCacheEntry>			   recent;			// most recently used first
+	size_t									   recent_bytes;	// of the responses in recent
+};
+
+static NativeIrCache *native_ir_cache = nullptr;
+
+// file mapping
+
+static bool native_file_map(const char *p_filename, NativeFileMapping *p_mapping)
+{
+	p_mapping->data = nullptr;
+	p_mapping->size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(p_filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	size.QuadPart = -1;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		// an empty file is fine, there's just nothing to map
+		bool empty = size.QuadPart == 0;
+		CloseHandle(file);
+		return empty;
+	}
+
+	// the view keeps the file open
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+
+	if (mapping == NULL)
+		return false;
+
+	p_mapping->data = (const uint8_t *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if (p_mapping->data == nullptr)
+		return false;
+
+	p_mapping->size = (size_t) size.QuadPart;
+#else
+	int file = open(p_filename, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	info.st_size = -1;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		// an empty file is fine, there's just nothing to map
+		bool empty = info.st_size == 0;
+		close(file);
+		return empty;
+	}
+
+	void *data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	p_mapping->data = (const uint8_t *) data;
+	p_mapping->size = (size_t) info.st_size;
+#endif
+
+	return true;
+}
+
+static void native_file_unmap(NativeFileMapping *p_mapping)
+{
+	if (p_mapping->data != nullptr)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(p_mapping->data);
+#else
+		munmap((void *) p_mapping->data, p_mapping->size);
+#endif
+	}
+
+	p_mapping->data = nullptr;
+	p_mapping->size = 0;
+}
+
+static bool native_file_truncate(const char *p_filename, size_t p_size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(p_filename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	size.QuadPart = (LONGLONG) p_size;
+	bool result = SetFilePointerEx(file, size, NULL, FILE_BEGIN) && SetEndOfFile(file);
+
+	CloseHandle(file);
+	return result;
+#else
+	return truncate(p_filename, (off_t) p_size) == 0;
+#endif
+}
+
+// cache file
+
+static uint64_t native_ir_cache_hash(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels)
+{
+	// FNV-1a, ReverbParameters is packed so its bytes are all there is to it
+	const uint64_t prime = 1099511628211ull;
+	const uint8_t *bytes = (const uint8_t *) p_params;
+	uint64_t hash = 14695981039346656037ull;
+
+	for (size_t idx = 0; idx < sizeof(ReverbParameters); ++idx)
+		hash = (hash ^ bytes[idx]) * prime;
+
+	hash = (hash ^ p_sample_rate) * prime;
+	hash = (hash ^ p_channels) * prime;
+
+	return hash;
+}
+
+static bool native_ir_cache_create_file(const char *p_filename)
+{
+	NativeIrCacheHeader header;
+	memcpy(header.magic, NATIVE_IR_CACHE_MAGIC, sizeof(header.magic));
+	header.version = NATIVE_IR_CACHE_VERSION;
+	header.byte_order = NATIVE_IR_CACHE_BYTE_ORDER;
+
+	FILE *file = fopen(p_filename, "wb");
+	if (file == nullptr)
+		return false;
+
+	bool result = fwrite(&header, sizeof(header), 1, file) == 1;
+	return (fclose(file) == 0) && result;
+}
+
+static bool native_ir_cache_valid_header(const NativeFileMapping *p_mapping)
+{
+	if (p_mapping->size < sizeof(NativeIrCacheHeader))
+		return false;
+
+	NativeIrCacheHeader header;
+	memcpy(&header, p_mapping->data, sizeof(header));
+
+	return memcmp(header.magic, NATIVE_IR_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+		   header.version == NATIVE_IR_CACHE_VERSION &&
+		   header.byte_order == NATIVE_IR_CACHE_BYTE_ORDER;
+}
+
+// indexes the records of the mapping, returns the end of the last complete one
+static size_t native_ir_cache_build_index(NativeIrCache *p_cache)
+{
+	const NativeFileMapping &mapping = p_cache->mapping;
+	size_t offset = sizeof(NativeIrCacheHeader);
+
+	p_cache->index.clear();
+
+	while (offset + sizeof(NativeIrCacheRecord) <= mapping.size)
+	{
+		NativeIrCacheRecord record;
+		memcpy(&record, mapping.data + offset, sizeof(record));
+
+		uint64_t bytes = (uint64_t) record.frames * record.channels * sizeof(float);
+
+		if (record.magic != NATIVE_IR_CACHE_RECORD || bytes > mapping.size - offset - sizeof(record))
+			break;
+
+		p_cache->index.emplace(record.hash, offset);
+		offset += sizeof(record) + (size_t) bytes;
+	}
+
+	return offset;
+}
+
+static bool native_ir_cache_map(NativeIrCache *p_cache)
+{
+	const char *filename = p_cache->filename.c_str();
+
+	// a missing file, or one of another version, starts over empty
+	if (!native_file_map(filename, &p_cache->mapping) || !native_ir_cache_valid_header(&p_cache->mapping))
+	{
+		native_file_unmap(&p_cache->mapping);
+
+		if (!native_ir_cache_create_file(filename) || !native_file_map(filename, &p_cache->mapping))
+			return false;
+	}
+
+	size_t end = native_ir_cache_build_index(p_cache);
+
+	// drop a record that was cut short, e.g. by a crash while it was appended, or the records after it would never be found
+	if (end < p_cache->mapping.size)
+	{
+		native_file_unmap(&p_cache->mapping);
+
+		if (!native_file_truncate(filename, end) || !native_file_map(filename, &p_cache->mapping))
+			return false;
+
+		native_ir_cache_build_index(p_cache);
+	}
+
+	return true;
+}
+
+static bool native_ir_cache_record_matches(const NativeIrCacheRecord *p_record, const ReverbParameters *p_params,
+										   unsigned int p_sample_rate, unsigned int p_channels)
+{
+	return p_record->sample_rate == p_sample_rate && p_record->channels == p_channels &&
+		   memcmp(&p_record->params, p_params, sizeof(ReverbParameters)) == 0;
+}
+
+static const float *native_ir_cache_find(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels, uint32_t *p_frames)
+{
+	const NativeFileMapping &mapping = native_ir_cache->mapping;
+	uint64_t hash = native_ir_cache_hash(p_params, p_sample_rate, p_channels);
+	auto range = native_ir_cache->index.equal_range(hash);
+
+	for (auto entry = range.first; entry != range.second; ++entry)
+	{
+		NativeIrCacheRecord record;
+		memcpy(&record, mapping.data + entry->second, sizeof(record));
+
+		if (native_ir_cache_record_matches(&record, p_params, p_sample_rate, p_channels))
+		{
+			*p_frames = record.frames;
+			return (const float *) (mapping.data + entry->second + sizeof(record));
+		}
+	}
+
+	std::list<NativeIrCacheEntry> &recent = native_ir_cache->recent;
+
+	for (auto entry = recent.begin(); entry != recent.end(); ++entry)
+	{
+		if (entry->record.hash == hash && native_ir_cache_record_matches(&entry->record, p_params, p_sample_rate, p_channels))
+		{
+			// moving the entry to the front keeps its response where it is
+			recent.splice(recent.begin(), recent, entry);
+
+			*p_frames = entry->record.frames;
+			return entry->response.data();
+		}
+	}
+
+	return nullptr;
+}
+
+static bool native_ir_cache_is_preset(const ReverbParameters *p_params)
+{
+	for (size_t preset = 0; preset < audio_reverb_preset_count; ++preset)
+	{
+		ReverbParameters params = audio_reverb_presets[preset];
+		params.WetDryMix = p_params->WetDryMix;
+
+		if (memcmp(&params, p_params, sizeof(ReverbParameters)) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+// keeps a copy of the response in memory, drops the least recently used ones when over the limit. Returns the copy.
+static const float *native_ir_cache_keep(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels,
+										 const float *p_response, uint32_t p_frames)
+{
+	NativeIrCacheEntry entry;
+	entry.record.magic = NATIVE_IR_CACHE_RECORD;
+	entry.record.sample_rate = p_sample_rate;
+	entry.record.channels = p_channels;
+	entry.record.frames = p_frames;
+	entry.record.hash = native_ir_cache_hash(p_params, p_sample_rate, p_channels);
+	entry.record.params = *p_params;
+	entry.response.assign(p_response, p_response + (size_t) p_frames * p_channels);
+
+	std::list<NativeIrCacheEntry> &recent = native_ir_cache->recent;
+
+	recent.push_front(std::move(entry));
+	native_ir_cache->recent_bytes += recent.front().response.size() * sizeof(float);
+
+	// the new one stays, even when it's over the limit by itself
+	while (native_ir_cache->recent_bytes > NATIVE_IR_CACHE_MEMORY_LIMIT && recent.size() > 1)
+	{
+		native_ir_cache->recent_bytes -= recent.back().response.size() * sizeof(float);
+		recent.pop_back();
+	}
+
+	return recent.front().response.data();
+}
+
+static bool native_ir_cache_append(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels,
+								   const float *p_response, uint32_t p_frames)
+{
+	NativeIrCacheRecord record;
+	record.magic = NATIVE_IR_CACHE_RECORD;
+	record.sample_rate = p_sample_rate;
+	record.channels = p_channels;
+	record.frames = p_frames;
+	record.hash = native_ir_cache_hash(p_params, p_sample_rate, p_channels);
+	record.params = *p_params;
+
+	native_file_unmap(&native_ir_cache->mapping);
+	native_ir_cache->index.clear();
+
+	bool result = false;
+	FILE *file = fopen(native_ir_cache->filename.c_str(), "ab");
+
+	if (file != nullptr)
+	{
+		result = fwrite(&record, sizeof(record), 1, file) == 1 &&
+				 fwrite(p_response, sizeof(float) * p_channels, p_frames, file) == p_frames;
+		result = (fclose(file) == 0) && result;
+	}
+
+	// this also drops the record again when it was only partly written
+	if (!native_ir_cache_map(native_ir_cache))
+	{
+		printf("Error: lost the impulse response cache %s\n", native_ir_cache->filename.c_str());
+		native_ir_cache_close();
+		return false;
+	}
+
+	return result;
+}
+
+// interface functions
+
+bool native_ir_cache_open(const char *p_filename)
+{
+	native_ir_cache_close();
+
+	NativeIrCache *cache = new NativeIrCache();
+	cache->filename = p_filename;
+	cache->mapping.data = nullptr;
+	cache->mapping.size = 0;
+	cache->recent_bytes = 0;
+
+	if (!native_ir_cache_map(cache))
+	{
+		native_file_unmap(&cache->mapping);
+		delete cache;
+		return false;
+	}
+
+	native_ir_cache = cache;
+	return true;
+}
+
+void native_ir_cache_close()
+{
+	if (native_ir_cache == nullptr)
+		return;
+
+	native_file_unmap(&native_ir_cache->mapping);
+	delete native_ir_cache;
+	native_ir_cache = nullptr;
+}
+
+bool native_ir_cache_is_open()
+{
+	return native_ir_cache != nullptr;
+}
+
+size_t native_ir_cache_count()
+{
+	return (native_ir_cache != nullptr) ? native_ir_cache->index.size() + native_ir_cache->recent.size() : 0;
+}
+
+const float *native_ir_cache_response(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels,
+									  uint32_t *p_frames, std::vector<float> &p_scratch)
+{
+	// the response is captured at full wet level, all mixes share it
+	ReverbParameters params = *p_params;
+	params.WetDryMix = 100.0f;
+
+	if (native_ir_cache != nullptr)
+	{
+		const float *cached = native_ir_cache_find(&params, p_sample_rate, p_channels, p_frames);
+		if (cached != nullptr)
+			return cached;
+	}
+
+	uint32_t length = native_reverb_response_length(&params, p_sample_rate);
+	p_scratch.resize((size_t) length * p_channels);
+
+	uint32_t audible = native_reverb_capture_response(&params, p_sample_rate, p_channels, p_scratch.data(), length);
+	*p_frames = (audible > 0) ? audible : 1;
+
+	if (native_ir_cache == nullptr)
+		return p_scratch.data();
+
+	// only the presets go to the file, that keeps it from growing with every parameter set that was ever tried
+	size_t record_bytes = sizeof(NativeIrCacheRecord) + (size_t) *p_frames * p_channels * sizeof(float);
+
+	if (native_ir_cache_is_preset(&params) && native_ir_cache->mapping.size + record_bytes <= NATIVE_IR_CACHE_FILE_LIMIT &&
+		native_ir_cache_append(&params, p_sample_rate, p_channels, p_scratch.data(), *p_frames))
+	{
+		const float *cached = native_ir_cache_find(&params, p_sample_rate, p_channels, p_frames);
+		if (cached != nullptr)
+			return cached;
+	}
+
+	// append closes the cache when it loses the file
+	if (native_ir_cache != nullptr)
+		return native_ir_cache_keep(&params, p_sample_rate, p_channels, p_scratch.data(), *p_frames);
+
+	return p_scratch.data();
+}
+
+size_t native_ir_cache_precompute(unsigned int p_sample_rate, unsigned int p_channels)
+{
+	std::vector<float> scratch;
+	size_t result = 0;
+
+	for (size_t preset = 0; preset < audio_reverb_preset_count && native_ir_cache != nullptr; ++preset)
+	{
+		ReverbParameters params = audio_reverb_presets[preset];
+		params.WetDryMix = 100.0f;
+
+		uint32_t frames;
+		if (native_ir_cache_find(&params, p_sample_rate, p_channels, &frames) != nullptr)
+			continue;
+
+		native_ir_cache_response(&params, p_sample_rate, p_channels, &frames, scratch);
+		++result;
+	}
+
+	return result;
+}
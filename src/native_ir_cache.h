@@ -0,0 +1,47 @@
+#ifndef FAUDIOFILTERDEMO_NATIVE_IR_CACHE_H
+#define FAUDIOFILTERDEMO_NATIVE_IR_CACHE_H
+
+#include "audio.h"
+
+#include <vector>
+
+// persistent cache of the impulse responses captured for the convolution mode, so they are only rendered once per
+//	parameter set instead of once per session. The file is a header followed by records, each the ReverbParameters, sample
+//	rate and channel count a response was captured with and then the interleaved response. It is memory-mapped when
+//	opened and the record headers are indexed by a hash of the ReverbParameters bytes, responses are only paged in when
+//	they are used.
+//
+//	Only the responses of audio_reverb_presets are appended to the file, as long as it stays within
+//	NATIVE_IR_CACHE_FILE_LIMIT. Every other response, e.g. of parameters edited in the GUI, is only kept in memory while
+//	the cache is open, the least recently used ones are dropped once they take more than NATIVE_IR_CACHE_MEMORY_LIMIT.
+//
+//	The file is native endian and only valid for the reverb that wrote it: bump NATIVE_IR_CACHE_VERSION whenever the output
+//	of native_reverb_capture_response or what the file holds changes, files of another version are discarded when opened.
+//
+//	The cache is process-wide and not thread safe, use it from the thread that changes the effect.
+
+const uint32_t NATIVE_IR_CACHE_VERSION = 2;
+const size_t NATIVE_IR_CACHE_FILE_LIMIT = 256 << 20;		// the presets take about 140 MB for stereo and 5.1
+const size_t NATIVE_IR_CACHE_MEMORY_LIMIT = 64 << 20;		// the longest 5.1 response takes about 15 MB
+
+// maps p_filename, or creates it when it doesn't exist or isn't a valid cache. Returns false when the file can't be used,
+//	the cache stays closed then.
+bool native_ir_cache_open(const char *p_filename);
+void native_ir_cache_close();
+bool native_ir_cache_is_open();
+
+// number of responses in the cache, in the file and in memory
+size_t native_ir_cache_count();
+
+// the response for the convolution mode of p_params, WetDryMix is ignored. Taken from the cache when it's there, otherwise
+//	it's captured and, when the cache is open, added to it. Returns p_frames interleaved frames of p_channels, which point
+//	into the mapped file, the memory of the cache or p_scratch and stay valid until the next call of a native_ir_cache
+//	function.
+const float *native_ir_cache_response(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_channels,
+									  uint32_t *p_frames, std::vector<float> &p_scratch);
+
+// adds the responses of every entry of audio_reverb_presets that isn't cached yet, nothing when the cache isn't open.
+//	Returns the number of responses captured.
+size_t native_ir_cache_precompute(unsigned int p_sample_rate, unsigned int p_channels);
+
+#endif // FAUDIOFILTERDEMO_NATIVE_IR_CACHE_H
@@ -0,0 +1,894 @@
+#include "native_reverb.h"
+#include "native_reverb_kernels.h"
+
+#include <math.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#ifdef NATIVE_REVERB_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// limits of the ReverbParameters fields, the delay memory is sized for them once so set_params never allocates
+const float NATIVE_REVERB_MAX_REFLECTIONS_DELAY = 300.0f;	// ms
+const float NATIVE_REVERB_MAX_REVERB_DELAY = 85.0f;			// ms
+const float NATIVE_REVERB_MAX_REAR_DELAY = 20.0f;			// ms
+
+// base timings in ms at a RoomSize of 100 feet
+static const float native_early_tap_ms[NATIVE_REVERB_TAPS] = { 0.0f, 3.1f, 7.3f, 11.9f, 17.3f, 23.1f, 29.9f, 37.7f };
+static const float native_early_tap_gain[NATIVE_REVERB_TAPS] = { 1.0f, 0.84f, 0.72f, 0.61f, 0.52f, 0.44f, 0.37f, 0.31f };
+static const float native_line_ms[NATIVE_REVERB_LINES] = { 29.7f, 37.1f, 41.1f, 43.7f, 47.9f, 50.3f, 53.9f, 59.3f };
+
+// fixed diffusion allpasses: two per side for the early reflections, two in front of the feedback network
+static const float native_early_allpass_ms[4] = { 3.2f, 2.4f, 3.5f, 2.7f };
+static const float native_late_allpass_ms[2] = { 12.6f, 10.0f };
+
+struct NativePresetCoefficients;
+
+struct NativeAllpass
+{
+	std::vector<float> buffer;
+	uint32_t		   position;
+};
+
+struct NativeReverb
+{
+	unsigned int sample_rate;
+	unsigned int in_channels;
+	unsigned int out_channels;
+	uint32_t	 max_frames;
+
+	const NativeReverbKernels *kernels;
+	NativeReverbCoefficients   coefs;
+	ReverbParameters		   params;			// what coefs were computed from
+	const NativePresetCoefficients *presets;
+	NativeDelayFormat		   delay_format;
+
+	// input stage, the pre-delay line and the network lines are stored in delay_format
+	float			   room_state;
+	std::vector<uint8_t> predelay;
+	uint32_t		   predelay_mask;
+	uint32_t		   predelay_position;
+
+	// early reflections
+	NativeAllpass	   early_allpass[4];
+
+	// late reverb
+	NativeAllpass	   late_allpass[2];
+	std::vector<uint8_t> lines;
+	NativeNetwork	   network;
+
+	// rear outputs for 5.1, 2 interleaved channels
+	std::vector<float> rear;
+	uint32_t		   rear_mask;
+	uint32_t		   rear_position;
+
+	// per block: early left / right, late input, late output and wet signal (4 interleaved channels each)
+	std::vector<float> early;
+	std::vector<float> late_in;
+	std::vector<float> late;
+	std::vector<float> wet;
+};
+
+// kernel selection
+enum NativeKernelLevel {
+	NativeKernels_Scalar,
+	NativeKernels_SSE2,
+	NativeKernels_AVX2,
+	NativeKernels_AVX512,
+	NativeKernels_Count
+};
+
+static const NativeReverbKernels *native_kernel_sets[NativeKernels_Count] = {
+	&native_reverb_kernels_scalar,
+	&native_reverb_kernels_sse2,
+	&native_reverb_kernels_avx2,
+	&native_reverb_kernels_avx512
+};
+
+static const char *native_kernel_ids[NativeKernels_Count] = { "scalar", "sse2", "avx2", "avx512" };
+
+static int native_kernel_override = -1;
+
+static const char *native_delay_format_ids[NativeDelayFormat_Count] = { "float", "half", "int16" };
+static const size_t native_delay_format_bytes[NativeDelayFormat_Count] = { sizeof(float), sizeof(uint16_t), sizeof(int16_t) };
+
+static NativeDelayFormat native_delay_format = NativeDelayFormat_Float32;
+
+static int native_cpu_level()
+{
+	int result = NativeKernels_Scalar;
+
+#ifdef NATIVE_REVERB_X86
+	unsigned int leaf1[4] = { 0 };
+	unsigned int leaf7[4] = { 0 };
+	uint64_t xcr0 = 0;
+
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	int max_leaf = regs[0];
+	__cpuidex((int *) leaf1, 1, 0);
+	if (max_leaf >= 7)
+		__cpuidex((int *) leaf7, 7, 0);
+	if (leaf1[2] & (1u << 27))
+		xcr0 = _xgetbv(0);
+#else
+	unsigned int max_leaf = __get_cpuid_max(0, NULL);
+	__cpuid_count(1, 0, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+	if (max_leaf >= 7)
+		__cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+	if (leaf1[2] & (1u << 27))
+	{
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		xcr0 = ((uint64_t) edx << 32) | eax;
+	}
+#endif
+
+	// the OS has to save the ymm / zmm registers too (XCR0), not just the CPU support the instructions
+	bool os_ymm = (xcr0 & 0x06) == 0x06;
+	bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+	bool sse2 = (leaf1[3] & (1u << 26)) != 0;
+	bool fma = (leaf1[2] & (1u << 12)) != 0;
+	bool f16c = (leaf1[2] & (1u << 29)) != 0;
+	bool avx = (leaf1[2] & (1u << 28)) != 0;
+	bool avx2 = (leaf7[1] & (1u << 5)) != 0;
+	bool avx512f = (leaf7[1] & (1u << 16)) != 0;
+	bool avx512vl = (leaf7[1] & (1u << 31)) != 0;
+
+	if (sse2)
+		result = NativeKernels_SSE2;
+	if (result == NativeKernels_SSE2 && avx && avx2 && fma && f16c && os_ymm)
+		result = NativeKernels_AVX2;
+	if (result == NativeKernels_AVX2 && avx512f && avx512vl && os_zmm)
+		result = NativeKernels_AVX512;
+#endif
+
+	// fall back when the compiler could not build a set
+	while (result > NativeKernels_Scalar && native_kernel_sets[result]->network == nullptr)
+		--result;
+
+	return result;
+}
+
+// copies of the sets with the reduced precision kernels they lack taken from the next narrower set
+struct NativeResolvedKernels
+{
+	NativeReverbKernels sets[NativeKernels_Count];
+
+	NativeResolvedKernels()
+	{
+		for (int level = 0; level < NativeKernels_Count; ++level)
+		{
+			sets[level] = *native_kernel_sets[level];
+
+			if (level == NativeKernels_Scalar)
+				continue;
+
+			const NativeReverbKernels &narrower = sets[level - 1];
+
+			if (sets[level].mac_half == nullptr)
+				sets[level].mac_half = narrower.mac_half;
+			if (sets[level].mac_int16 == nullptr)
+				sets[level].mac_int16 = narrower.mac_int16;
+			if (sets[level].network_half == nullptr)
+				sets[level].network_half = narrower.network_half;
+			if (sets[level].network_int16 == nullptr)
+				sets[level].network_int16 = narrower.network_int16;
+		}
+	}
+};
+
+const NativeReverbKernels *native_reverb_kernels()
+{
+	static const int cpu_level = native_cpu_level();
+	static const NativeResolvedKernels resolved;
+	return &resolved.sets[(native_kernel_override >= 0) ? native_kernel_override : cpu_level];
+}
+
+bool native_reverb_select_kernels(const char *p_name)
+{
+	for (int level = 0; level < NativeKernels_Count; ++level)
+	{
+		if (strcmp(p_name, native_kernel_ids[level]) != 0)
+			continue;
+
+		if (level > native_cpu_level())
+			return false;
+
+		native_kernel_override = level;
+		return true;
+	}
+
+	return false;
+}
+
+const char *native_reverb_kernels_name()
+{
+	return native_reverb_kernels()->name;
+}
+
+bool native_reverb_select_delay_format(const char *p_name)
+{
+	for (int format = 0; format < NativeDelayFormat_Count; ++format)
+	{
+		if (strcmp(p_name, native_delay_format_ids[format]) == 0)
+		{
+			native_delay_format = (NativeDelayFormat) format;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char *native_reverb_delay_format_name()
+{
+	return native_delay_format_ids[native_delay_format];
+}
+
+// helpers
+static uint32_t native_next_pow2(uint32_t p_value)
+{
+	uint32_t result = 1;
+	while (result < p_value)
+		result <<= 1;
+	return result;
+}
+
+static uint32_t native_ms_to_frames(float p_ms, unsigned int p_sample_rate)
+{
+	return (uint32_t) (p_ms * p_sample_rate / 1000.0f + 0.5f);
+}
+
+static float native_db_to_gain(float p_db)
+{
+	return powf(10.0f, p_db / 20.0f);
+}
+
+static float native_one_pole(float p_frequency, unsigned int p_sample_rate)
+{
+	float nyquist_limit = 0.45f * p_sample_rate;
+	float frequency = (p_frequency < 1.0f) ? 1.0f : (p_frequency > nyquist_limit) ? nyquist_limit : p_frequency;
+	return 1.0f - expf(-2.0f * 3.14159265f * frequency / p_sample_rate);
+}
+
+// adds p_frames frames of a circular delay line in p_format, starting at p_start, to p_output
+static void native_line_read(const NativeReverbKernels *p_kernels, NativeDelayFormat p_format, float *p_output, const void *p_line,
+							 uint32_t p_mask, uint32_t p_start, uint32_t p_frames, float p_gain)
+{
+	while (p_frames > 0)
+	{
+		uint32_t idx = p_start & p_mask;
+		uint32_t count = p_mask + 1 - idx;
+		if (count > p_frames)
+			count = p_frames;
+
+		if (p_format == NativeDelayFormat_Float16)
+			p_kernels->mac_half(p_output, (const uint16_t *) p_line + idx, count, p_gain);
+		else if (p_format == NativeDelayFormat_Int16)
+			p_kernels->mac_int16(p_output, (const int16_t *) p_line + idx, count, p_gain);
+		else
+			p_kernels->mac(p_output, (const float *) p_line + idx, count, p_gain);
+
+		p_output += count;
+		p_start += count;
+		p_frames -= count;
+	}
+}
+
+// writes p_frames samples to a circular delay line, starting at p_start
+template <typename T>
+static void native_line_write(T *p_line, uint32_t p_mask, uint32_t p_start, const float *p_input, uint32_t p_frames)
+{
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		native_delay_store(p_line + ((p_start + frame) & p_mask), p_input[frame]);
+	}
+}
+
+// runs a block through an allpass in stretches that neither wrap the buffer nor exceed the delay length
+static void native_allpass_block(const NativeReverbKernels *p_kernels, NativeAllpass &p_allpass, float p_gain, float *p_samples, uint32_t p_frames)
+{
+	uint32_t size = (uint32_t) p_allpass.buffer.size();
+
+	while (p_frames > 0)
+	{
+		uint32_t count = size - p_allpass.position;
+		if (count > p_frames)
+			count = p_frames;
+
+		p_kernels->allpass(p_samples, p_allpass.buffer.data() + p_allpass.position, count, p_gain);
+
+		p_allpass.position += count;
+		if (p_allpass.position == size)
+			p_allpass.position = 0;
+
+		p_samples += count;
+		p_frames -= count;
+	}
+}
+
+// scalar kernels, also the reference for the vector versions
+template <typename T>
+static void native_mac_scalar_t(float *p_output, const T *p_input, uint32_t p_count, float p_gain)
+{
+	for (uint32_t idx = 0; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_delay_load(p_input + idx);
+	}
+}
+
+static void native_mac_scalar(float *p_output, const float *p_input, uint32_t p_count, float p_gain)
+{
+	native_mac_scalar_t(p_output, p_input, p_count, p_gain);
+}
+
+static void native_mac_half_scalar(float *p_output, const uint16_t *p_input, uint32_t p_count, float p_gain)
+{
+	native_mac_scalar_t(p_output, p_input, p_count, p_gain);
+}
+
+static void native_mac_int16_scalar(float *p_output, const int16_t *p_input, uint32_t p_count, float p_gain)
+{
+	native_mac_scalar_t(p_output, p_input, p_count, p_gain);
+}
+
+static void native_allpass_scalar(float *p_samples, float *p_buffer, uint32_t p_count, float p_gain)
+{
+	for (uint32_t idx = 0; idx < p_count; ++idx)
+	{
+		float delayed = p_buffer[idx];
+		float input = p_samples[idx];
+
+		p_samples[idx] = delayed - p_gain * input;
+		p_buffer[idx] = input + p_gain * delayed;
+	}
+}
+
+static void native_cmac_scalar(float *p_re, float *p_im, const float *p_a_re, const float *p_a_im, const float *p_b_re, const float *p_b_im, uint32_t p_count)
+{
+	for (uint32_t idx = 0; idx < p_count; ++idx)
+	{
+		p_re[idx] += p_a_re[idx] * p_b_re[idx] - p_a_im[idx] * p_b_im[idx];
+		p_im[idx] += p_a_re[idx] * p_b_im[idx] + p_a_im[idx] * p_b_re[idx];
+	}
+}
+
+template <typename T>
+static void native_network_scalar_t(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	T *lines = (T *) p_network->lines;
+	uint32_t line_mask = p_network->line_mask;
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		uint32_t position = p_network->line_position;
+		float y[NATIVE_REVERB_LINES];
+		float sum = 0.0f;
+
+		// read, damp and attenuate every line
+		for (unsigned int line = 0; line < NATIVE_REVERB_LINES; ++line)
+		{
+			float delayed = native_delay_load(lines + ((position - p_coefs->line_length[line]) & line_mask) * NATIVE_REVERB_LINES + line);
+			float &state = p_network->line_state[line];
+
+			state += p_coefs->damping_lp * (delayed - state) + NATIVE_REVERB_DENORMAL;
+			y[line] = p_coefs->line_gain[line] * (state + p_coefs->line_hf[line] * (delayed - state));
+			sum += y[line];
+		}
+
+		// feedback through the Householder-like matrix, plus the input with alternating signs
+		float feedback = p_coefs->density * sum;
+		T *write = lines + (position & line_mask) * NATIVE_REVERB_LINES;
+
+		for (unsigned int line = 0; line < NATIVE_REVERB_LINES; ++line)
+		{
+			native_delay_store(write + line, y[line] - feedback + ((line & 1) ? -p_input[frame] : p_input[frame]));
+		}
+
+		p_network->line_position = position + 1;
+
+		// decorrelated taps of the network: front left / right, rear left / right
+		float late[4] = {
+			y[0] - y[2] + y[4] - y[6],
+			y[1] - y[3] + y[5] - y[7],
+			y[0] + y[3] - y[4] - y[7],
+			y[1] + y[2] - y[5] - y[6]
+		};
+
+		for (unsigned int ch = 0; ch < 4; ++ch)
+		{
+			float &low = p_network->low_state[ch];
+
+			low += p_coefs->low_lp * (late[ch] - low) + NATIVE_REVERB_DENORMAL;
+			p_output[frame * 4 + ch] = p_coefs->reverb_gain * (late[ch] + (p_coefs->low_gain - 1.0f) * low);
+		}
+	}
+}
+
+static void native_network_scalar(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_scalar_t<float>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+static void native_network_half_scalar(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_scalar_t<uint16_t>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+static void native_network_int16_scalar(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_scalar_t<int16_t>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+const NativeReverbKernels native_reverb_kernels_scalar = {
+	"scalar",
+	native_mac_scalar,
+	native_allpass_scalar,
+	native_cmac_scalar,
+	native_network_scalar,
+	native_mac_half_scalar,
+	native_mac_int16_scalar,
+	native_network_half_scalar,
+	native_network_int16_scalar
+};
+
+// the coefficients are computed in sections, each from a few fields of ReverbParameters. native_reverb_set_params only
+//	recomputes the sections whose fields changed, e.g. dragging the RoomFreq slider doesn't recompute the 16 powf of the
+//	network lines every frame. The sections have to give exactly the same result as computing everything at once.
+struct NativeCoefficientSection
+{
+	uint32_t fields;		// AudioReverbField bits the section is computed from
+	void (*compute)(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs);
+};
+
+static float native_room_scale(const ReverbParameters *p_params)
+{
+	return 0.1f + 0.9f * fminf(fmaxf(p_params->RoomSize, 0.0f), 100.0f) / 100.0f;
+}
+
+static void native_mix_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	p_coefs->wet = fminf(fmaxf(p_params->WetDryMix, 0.0f), 100.0f) / 100.0f;
+	p_coefs->dry = 1.0f - p_coefs->wet;
+}
+
+static void native_input_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	p_coefs->room_lp = native_one_pole(p_params->RoomFilterFreq, p_sample_rate);
+	p_coefs->room_main = native_db_to_gain(p_params->RoomFilterMain);
+	p_coefs->room_hf = native_db_to_gain(p_params->RoomFilterHF);
+}
+
+static void native_early_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	float room_scale = native_room_scale(p_params);
+	float reflections_delay = fminf((float) p_params->ReflectionsDelay, NATIVE_REVERB_MAX_REFLECTIONS_DELAY);
+
+	for (unsigned int tap = 0; tap < NATIVE_REVERB_TAPS; ++tap)
+	{
+		p_coefs->early_tap_delay[tap] = native_ms_to_frames(reflections_delay + native_early_tap_ms[tap] * room_scale, p_sample_rate);
+		p_coefs->early_tap_gain[tap] = native_early_tap_gain[tap];
+	}
+
+	p_coefs->early_diffusion = 0.7f * p_params->EarlyDiffusion / 15.0f;
+	p_coefs->early_cross[0] = 0.5f * p_params->PositionLeft / 30.0f;
+	p_coefs->early_cross[1] = 0.5f * p_params->PositionRight / 30.0f;
+	p_coefs->reflections_gain = native_db_to_gain(p_params->ReflectionsGain);
+}
+
+static void native_late_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	float reflections_delay = fminf((float) p_params->ReflectionsDelay, NATIVE_REVERB_MAX_REFLECTIONS_DELAY);
+	float reverb_delay = fminf((float) p_params->ReverbDelay, NATIVE_REVERB_MAX_REVERB_DELAY);
+	float rear_delay = fminf((float) p_params->RearDelay, NATIVE_REVERB_MAX_REAR_DELAY);
+
+	p_coefs->reverb_delay = native_ms_to_frames(reflections_delay + reverb_delay, p_sample_rate);
+	p_coefs->late_diffusion = 0.7f * p_params->LateDiffusion / 15.0f;
+	p_coefs->density = (2.0f / NATIVE_REVERB_LINES) * fminf(fmaxf(p_params->Density, 0.0f), 100.0f) / 100.0f;
+	p_coefs->late_cross[0] = 0.5f * p_params->PositionMatrixLeft / 30.0f;
+	p_coefs->late_cross[1] = 0.5f * p_params->PositionMatrixRight / 30.0f;
+	p_coefs->rear_delay = native_ms_to_frames(rear_delay, p_sample_rate);
+}
+
+// the gain of every line gives a 60dB decay after DecayTime, the high frequencies decay faster
+static void native_lines_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	float room_scale = native_room_scale(p_params);
+	float decay = fmaxf(p_params->DecayTime, 0.1f);
+	float decay_hf = decay * native_db_to_gain((float) p_params->HighEQGain - 8.0f);
+
+	for (unsigned int line = 0; line < NATIVE_REVERB_LINES; ++line)
+	{
+		uint32_t length = native_ms_to_frames(native_line_ms[line] * room_scale, p_sample_rate);
+		p_coefs->line_length[line] = (length < 2) ? 2 : length;		// the AVX-512 network runs two frames at once
+
+		float seconds = (float) p_coefs->line_length[line] / p_sample_rate;
+		p_coefs->line_gain[line] = powf(10.0f, -3.0f * seconds / decay);
+		p_coefs->line_hf[line] = powf(10.0f, -3.0f * seconds / decay_hf) / p_coefs->line_gain[line];
+	}
+}
+
+static void native_output_compute(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs)
+{
+	p_coefs->damping_lp = native_one_pole(1000.0f + 500.0f * p_params->HighEQCutoff, p_sample_rate);
+	p_coefs->low_lp = native_one_pole(50.0f + 50.0f * p_params->LowEQCutoff, p_sample_rate);
+	p_coefs->low_gain = native_db_to_gain((float) p_params->LowEQGain - 8.0f);
+
+	// every late output sums 4 lines
+	p_coefs->reverb_gain = 0.5f * native_db_to_gain(p_params->ReverbGain);
+}
+
+static const NativeCoefficientSection native_coefficient_sections[] = {
+	{ AudioReverbField_WetDryMix,
+	  native_mix_compute },
+	{ AudioReverbField_RoomFilterFreq | AudioReverbField_RoomFilterMain | AudioReverbField_RoomFilterHF,
+	  native_input_compute },
+	{ AudioReverbField_ReflectionsDelay | AudioReverbField_RoomSize | AudioReverbField_EarlyDiffusion |
+	  AudioReverbField_PositionLeft | AudioReverbField_PositionRight | AudioReverbField_ReflectionsGain,
+	  native_early_compute },
+	{ AudioReverbField_ReflectionsDelay | AudioReverbField_ReverbDelay | AudioReverbField_LateDiffusion | AudioReverbField_Density |
+	  AudioReverbField_PositionMatrixLeft | AudioReverbField_PositionMatrixRight | AudioReverbField_RearDelay,
+	  native_late_compute },
+	{ AudioReverbField_RoomSize | AudioReverbField_DecayTime | AudioReverbField_HighEQGain,
+	  native_lines_compute },
+	{ AudioReverbField_HighEQCutoff | AudioReverbField_LowEQCutoff | AudioReverbField_LowEQGain | AudioReverbField_ReverbGain,
+	  native_output_compute }
+};
+
+void native_reverb_compute_coefficients(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs,
+										uint32_t p_fields)
+{
+	for (const NativeCoefficientSection &section : native_coefficient_sections)
+	{
+		if (section.fields & p_fields)
+			section.compute(p_params, p_sample_rate, p_coefs);
+	}
+}
+
+// coefficients of the built-in presets, computed once per sample rate when the first reverb for it is created and never
+//	freed, so native_reverb_set_params turns a preset switch into a copy. The tables are only ever added to, a reverb
+//	keeps a pointer to its own.
+struct NativePresetCoefficients
+{
+	unsigned int sample_rate;
+	std::vector<NativeReverbCoefficients> coefs;
+};
+
+static std::mutex native_preset_lock;
+static std::vector<NativePresetCoefficients *> native_preset_tables;
+
+static const NativePresetCoefficients *native_preset_coefficients(unsigned int p_sample_rate)
+{
+	std::lock_guard<std::mutex> lock(native_preset_lock);
+
+	for (const NativePresetCoefficients *table : native_preset_tables)
+	{
+		if (table->sample_rate == p_sample_rate)
+			return table;
+	}
+
+	NativePresetCoefficients *table = new NativePresetCoefficients();
+	table->sample_rate = p_sample_rate;
+	table->coefs.resize(audio_reverb_preset_count);
+
+	for (size_t idx = 0; idx < audio_reverb_preset_count; ++idx)
+		native_reverb_compute_coefficients(&audio_reverb_presets[idx], p_sample_rate, &table->coefs[idx]);
+
+	native_preset_tables.push_back(table);
+	return table;
+}
+
+static NativeReverb *native_reverb_create_format(unsigned int p_sample_rate, unsigned int p_in_channels, unsigned int p_out_channels,
+												 uint32_t p_max_frames, NativeDelayFormat p_format)
+{
+	NativeReverb *result = new NativeReverb();
+	result->sample_rate = p_sample_rate;
+	result->in_channels = p_in_channels;
+	result->out_channels = p_out_channels;
+	result->max_frames = p_max_frames;
+	result->kernels = native_reverb_kernels();
+	result->delay_format = p_format;
+
+	// the 16 bit network lines get a spare element for the gathers, see NativeNetwork
+	size_t sample_bytes = native_delay_format_bytes[p_format];
+	size_t spare_bytes = (sample_bytes < sizeof(float)) ? sample_bytes : 0;
+
+	// a whole block is written to the pre-delay line before it is read, hence the extra p_max_frames
+	float max_early_ms = NATIVE_REVERB_MAX_REFLECTIONS_DELAY + native_early_tap_ms[NATIVE_REVERB_TAPS - 1];
+	float max_predelay_ms = fmaxf(max_early_ms, NATIVE_REVERB_MAX_REFLECTIONS_DELAY + NATIVE_REVERB_MAX_REVERB_DELAY);
+	uint32_t predelay_size = native_next_pow2(native_ms_to_frames(max_predelay_ms, p_sample_rate) + p_max_frames + 1);
+
+	result->predelay.resize(predelay_size * sample_bytes);
+	result->predelay_mask = predelay_size - 1;
+
+	for (unsigned int idx = 0; idx < 4; ++idx)
+		result->early_allpass[idx].buffer.resize(native_ms_to_frames(native_early_allpass_ms[idx], p_sample_rate));
+
+	for (unsigned int idx = 0; idx < 2; ++idx)
+		result->late_allpass[idx].buffer.resize(native_ms_to_frames(native_late_allpass_ms[idx], p_sample_rate));
+
+	uint32_t line_size = native_next_pow2(native_ms_to_frames(native_line_ms[NATIVE_REVERB_LINES - 1], p_sample_rate) + 1);
+	result->lines.resize(NATIVE_REVERB_LINES * line_size * sample_bytes + spare_bytes);
+	result->network.lines = result->lines.data();
+	result->network.line_mask = line_size - 1;
+
+	uint32_t rear_size = native_next_pow2(native_ms_to_frames(NATIVE_REVERB_MAX_REAR_DELAY, p_sample_rate) + 1);
+	result->rear.resize(2 * rear_size);
+	result->rear_mask = rear_size - 1;
+
+	result->early.resize(2 * p_max_frames);
+	result->late_in.resize(p_max_frames);
+	result->late.resize(4 * p_max_frames);
+	result->wet.resize(4 * p_max_frames);
+
+	native_reverb_reset(result);
+
+	result->presets = native_preset_coefficients(p_sample_rate);
+	result->params = audio_reverb_presets[0];
+	result->coefs = result->presets->coefs[0];
+
+	return result;
+}
+
+NativeReverb *native_reverb_create(unsigned int p_sample_rate, unsigned int p_in_channels, unsigned int p_out_channels, uint32_t p_max_frames)
+{
+	return native_reverb_create_format(p_sample_rate, p_in_channels, p_out_channels, p_max_frames, native_delay_format);
+}
+
+void native_reverb_destroy(NativeReverb *p_reverb)
+{
+	delete p_reverb;
+}
+
+void native_reverb_set_params(NativeReverb *p_reverb, const ReverbParameters *p_params)
+{
+	uint32_t changed = audio_reverb_changed_fields(&p_reverb->params, p_params);
+
+	if (changed == 0)
+		return;
+
+	for (size_t idx = 0; idx < p_reverb->presets->coefs.size(); ++idx)
+	{
+		if (memcmp(p_params, &audio_reverb_presets[idx], sizeof(ReverbParameters)) == 0)
+		{
+			p_reverb->coefs = p_reverb->presets->coefs[idx];
+			p_reverb->params = *p_params;
+			return;
+		}
+	}
+
+	native_reverb_compute_coefficients(p_params, p_reverb->sample_rate, &p_reverb->coefs, changed);
+	p_reverb->params = *p_params;
+}
+
+const NativeReverbCoefficients *native_reverb_coefficients(const NativeReverb *p_reverb)
+{
+	return &p_reverb->coefs;
+}
+
+void native_reverb_reset(NativeReverb *p_reverb)
+{
+	p_reverb->room_state = 0.0f;
+	memset(p_reverb->predelay.data(), 0, p_reverb->predelay.size());
+	p_reverb->predelay_position = 0;
+
+	for (auto &allpass : p_reverb->early_allpass)
+	{
+		memset(allpass.buffer.data(), 0, sizeof(float) * allpass.buffer.size());
+		allpass.position = 0;
+	}
+
+	for (auto &allpass : p_reverb->late_allpass)
+	{
+		memset(allpass.buffer.data(), 0, sizeof(float) * allpass.buffer.size());
+		allpass.position = 0;
+	}
+
+	memset(p_reverb->lines.data(), 0, p_reverb->lines.size());
+	p_reverb->network.line_position = 0;
+	memset(p_reverb->network.line_state, 0, sizeof(p_reverb->network.line_state));
+	memset(p_reverb->network.low_state, 0, sizeof(p_reverb->network.low_state));
+
+	memset(p_reverb->rear.data(), 0, sizeof(float) * p_reverb->rear.size());
+	p_reverb->rear_position = 0;
+}
+
+void native_reverb_process(NativeReverb *p_reverb, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	const NativeReverbKernels *kernels = p_reverb->kernels;
+	const NativeReverbCoefficients &coefs = p_reverb->coefs;
+	NativeDelayFormat delay_format = p_reverb->delay_format;
+	unsigned int in_channels = p_reverb->in_channels;
+	unsigned int out_channels = p_reverb->out_channels;
+
+	if (p_frames > p_reverb->max_frames)
+		p_frames = p_reverb->max_frames;
+
+	// downmix and room filter into the pre-delay line, late_in holds the block until it's stored
+	void *predelay = p_reverb->predelay.data();
+	uint32_t predelay_mask = p_reverb->predelay_mask;
+	uint32_t now = p_reverb->predelay_position;
+	float in_scale = 1.0f / in_channels;
+	float *room = p_reverb->late_in.data();
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		float x = 0.0f;
+		for (unsigned int ch = 0; ch < in_channels; ++ch)
+			x += p_input[frame * in_channels + ch];
+		x *= in_scale;
+
+		p_reverb->room_state += coefs.room_lp * (x - p_reverb->room_state) + NATIVE_REVERB_DENORMAL;
+		room[frame] = coefs.room_main * (p_reverb->room_state + coefs.room_hf * (x - p_reverb->room_state));
+	}
+
+	if (delay_format == NativeDelayFormat_Float16)
+		native_line_write((uint16_t *) predelay, predelay_mask, now, room, p_frames);
+	else if (delay_format == NativeDelayFormat_Int16)
+		native_line_write((int16_t *) predelay, predelay_mask, now, room, p_frames);
+	else
+		native_line_write((float *) predelay, predelay_mask, now, room, p_frames);
+
+	p_reverb->predelay_position += p_frames;
+
+	// early reflections: even taps feed the left side, odd taps the right side
+	float *early[2] = { p_reverb->early.data(), p_reverb->early.data() + p_frames };
+	memset(p_reverb->early.data(), 0, sizeof(float) * 2 * p_frames);
+
+	for (unsigned int tap = 0; tap < NATIVE_REVERB_TAPS; ++tap)
+	{
+		native_line_read(kernels, delay_format, early[tap & 1], predelay, predelay_mask, now - coefs.early_tap_delay[tap], p_frames, coefs.early_tap_gain[tap]);
+	}
+
+	native_allpass_block(kernels, p_reverb->early_allpass[0], coefs.early_diffusion, early[0], p_frames);
+	native_allpass_block(kernels, p_reverb->early_allpass[1], coefs.early_diffusion, early[0], p_frames);
+	native_allpass_block(kernels, p_reverb->early_allpass[2], coefs.early_diffusion, early[1], p_frames);
+	native_allpass_block(kernels, p_reverb->early_allpass[3], coefs.early_diffusion, early[1], p_frames);
+
+	// late reverb: diffuse the delayed input and run it through the network
+	float *late_in = p_reverb->late_in.data();
+	memset(late_in, 0, sizeof(float) * p_frames);
+
+	native_line_read(kernels, delay_format, late_in, predelay, predelay_mask, now - coefs.reverb_delay, p_frames, 1.0f);
+	native_allpass_block(kernels, p_reverb->late_allpass[0], coefs.late_diffusion, late_in, p_frames);
+	native_allpass_block(kernels, p_reverb->late_allpass[1], coefs.late_diffusion, late_in, p_frames);
+
+	float *late = p_reverb->late.data();
+	if (delay_format == NativeDelayFormat_Float16)
+		kernels->network_half(&p_reverb->network, &coefs, late_in, late, p_frames);
+	else if (delay_format == NativeDelayFormat_Int16)
+		kernels->network_int16(&p_reverb->network, &coefs, late_in, late, p_frames);
+	else
+		kernels->network(&p_reverb->network, &coefs, late_in, late, p_frames);
+
+	// combine into the wet signal, with the cross-feed of the position settings
+	float *wet = p_reverb->wet.data();
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		float early_l = coefs.reflections_gain * (early[0][frame] + coefs.early_cross[0] * (early[1][frame] - early[0][frame]));
+		float early_r = coefs.reflections_gain * (early[1][frame] + coefs.early_cross[1] * (early[0][frame] - early[1][frame]));
+		const float *l = late + frame * 4;
+
+		wet[frame * 4 + 0] = early_l + l[0] + coefs.late_cross[0] * (l[1] - l[0]);
+		wet[frame * 4 + 1] = early_r + l[1] + coefs.late_cross[1] * (l[0] - l[1]);
+		wet[frame * 4 + 2] = early_l + l[2] + coefs.late_cross[0] * (l[3] - l[2]);
+		wet[frame * 4 + 3] = early_r + l[3] + coefs.late_cross[1] * (l[2] - l[3]);
+	}
+
+	// mix dry and wet signal into the output layout
+	float *rear = p_reverb->rear.data();
+	uint32_t rear_mask = p_reverb->rear_mask;
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		const float *in = p_input + frame * in_channels;
+		float *out = p_output + frame * out_channels;
+
+		float dry_l = in[0];
+		float dry_r = (in_channels > 1) ? in[1] : in[0];
+
+		out[0] = coefs.dry * dry_l + coefs.wet * wet[frame * 4 + 0];
+		out[1] = coefs.dry * dry_r + coefs.wet * wet[frame * 4 + 1];
+
+		if (out_channels == 6)
+		{
+			uint32_t write = p_reverb->rear_position & rear_mask;
+			uint32_t read = (p_reverb->rear_position - coefs.rear_delay) & rear_mask;
+
+			rear[write * 2 + 0] = wet[frame * 4 + 2];
+			rear[write * 2 + 1] = wet[frame * 4 + 3];
+			++p_reverb->rear_position;
+
+			out[2] = 0.0f;
+			out[3] = 0.0f;
+			out[4] = coefs.wet * rear[read * 2 + 0];
+			out[5] = coefs.wet * rear[read * 2 + 1];
+		}
+	}
+}
+
+size_t native_reverb_bytes_in_use(const NativeReverb *p_reverb)
+{
+	size_t result = sizeof(NativeReverb);
+
+	result += p_reverb->predelay.capacity();
+	for (auto &allpass : p_reverb->early_allpass)
+		result += allpass.buffer.capacity() * sizeof(float);
+	for (auto &allpass : p_reverb->late_allpass)
+		result += allpass.buffer.capacity() * sizeof(float);
+	result += p_reverb->lines.capacity();
+	result += p_reverb->rear.capacity() * sizeof(float);
+	result += p_reverb->early.capacity() * sizeof(float);
+	result += p_reverb->late_in.capacity() * sizeof(float);
+	result += p_reverb->late.capacity() * sizeof(float);
+	result += p_reverb->wet.capacity() * sizeof(float);
+
+	return result;
+}
+
+uint32_t native_reverb_response_length(const ReverbParameters *p_params, unsigned int p_sample_rate)
+{
+	// the delays plus 1.5 times the 60dB decay, which ends 90dB down, plus the ringing of the diffusers and filters that
+	//	dominates short decays
+	float delays = fminf((float) p_params->ReflectionsDelay, NATIVE_REVERB_MAX_REFLECTIONS_DELAY) + p_params->ReverbDelay + p_params->RearDelay;
+	float seconds = delays / 1000.0f + 1.5f * fmaxf(p_params->DecayTime, 0.1f) + 0.25f;
+
+	return (uint32_t) (fminf(seconds, NATIVE_REVERB_MAX_RESPONSE) * p_sample_rate);
+}
+
+uint32_t native_reverb_capture_response(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_out_channels,
+										float *p_response, uint32_t p_frames)
+{
+	const uint32_t block = 1024;
+
+	// always in float: the responses are cached without regard to the delay format
+	NativeReverb *reverb = native_reverb_create_format(p_sample_rate, 1, p_out_channels, block, NativeDelayFormat_Float32);
+
+	ReverbParameters params = *p_params;
+	params.WetDryMix = 100.0f;
+	native_reverb_set_params(reverb, &params);
+
+	std::vector<float> input(block, 0.0f);
+	input[0] = 1.0f;
+
+	for (uint32_t frame = 0; frame < p_frames; frame += block)
+	{
+		uint32_t count = (p_frames - frame < block) ? p_frames - frame : block;
+		native_reverb_process(reverb, input.data(), p_response + frame * p_out_channels, count);
+		input[0] = 0.0f;
+	}
+
+	native_reverb_destroy(reverb);
+
+	// cut the tail once it stays below -100dB of the peak
+	float peak = 0.0f;
+	for (uint32_t idx = 0; idx < p_frames * p_out_channels; ++idx)
+		peak = fmaxf(peak, fabsf(p_response[idx]));
+
+	float threshold = peak * 1e-5f;
+	uint32_t result = p_frames;
+
+	while (result > 0)
+	{
+		bool audible = false;
+		for (unsigned int ch = 0; ch < p_out_channels && !audible; ++ch)
+			audible = fabsf(p_response[(result - 1) * p_out_channels + ch]) > threshold;
+
+		if (audible)
+			break;
+
+		--result;
+	}
+
+	return result;
+}
@@ -0,0 +1,114 @@
+#ifndef FAUDIOFILTERDEMO_NATIVE_REVERB_H
+#define FAUDIOFILTERDEMO_NATIVE_REVERB_H
+
+#include "audio.h"
+
+// in-repo reverb driven directly by ReverbParameters, without FAudio or XAudio2. The input is downmixed to mono, runs
+//	through the room filter into a pre-delay line; early reflections are tapped from that line and diffused per side, the
+//	late reverb is an 8 line feedback delay network with frequency dependent decay.
+//
+//	Mapping of the less obvious fields:
+//	- RoomSize scales the early tap times and the feedback delay lengths (10% - 100% of their base length)
+//	- Density blends the feedback matrix from the identity (parallel combs, sparse) to a full Householder reflection
+//	- HighEQGain / HighEQCutoff set the decay time above the cutoff relative to DecayTime (0 = 40%, 8 = 100%)
+//	- LowEQGain / LowEQCutoff are a shelf on the late reverb output (-8 dB - +4 dB)
+//	- Position* / PositionMatrix* cross-feed the left and right early / late outputs (0 = none, 30 = mono)
+
+const unsigned int NATIVE_REVERB_LINES = 8;
+const unsigned int NATIVE_REVERB_TAPS = 8;
+
+// derived per-sample-rate state of a ReverbParameters set, delays in frames and gains linear
+struct NativeReverbCoefficients
+{
+	float	 wet;
+	float	 dry;
+
+	float	 room_lp;						// one-pole coefficient of the room filter at RoomFilterFreq
+	float	 room_main;
+	float	 room_hf;
+
+	uint32_t early_tap_delay[NATIVE_REVERB_TAPS];
+	float	 early_tap_gain[NATIVE_REVERB_TAPS];
+	float	 early_diffusion;
+	float	 early_cross[2];
+	float	 reflections_gain;
+
+	uint32_t reverb_delay;
+	float	 late_diffusion;
+	uint32_t line_length[NATIVE_REVERB_LINES];
+	float	 line_gain[NATIVE_REVERB_LINES];
+	float	 line_hf[NATIVE_REVERB_LINES];		// extra attenuation per pass above the high EQ cutoff
+	float	 damping_lp;
+	float	 density;
+	float	 late_cross[2];
+	float	 low_lp;
+	float	 low_gain;
+	float	 reverb_gain;
+
+	uint32_t rear_delay;
+};
+
+struct NativeReverb;
+
+// p_fields (AudioReverbField bits) limits the computation to the coefficients that depend on those fields, the others
+//	in p_coefs are left as they are
+void native_reverb_compute_coefficients(const ReverbParameters *p_params, unsigned int p_sample_rate, NativeReverbCoefficients *p_coefs,
+										uint32_t p_fields = AudioReverbField_All);
+
+// p_in_channels is 1 or 2, p_out_channels 2 or 6. p_max_frames is the largest block native_reverb_process will be asked for.
+NativeReverb *native_reverb_create(unsigned int p_sample_rate, unsigned int p_in_channels, unsigned int p_out_channels, uint32_t p_max_frames);
+void native_reverb_destroy(NativeReverb *p_reverb);
+
+// never allocates, safe to call between two blocks on the audio thread. Only the coefficients that depend on the changed
+//	fields are recomputed, the built-in presets are looked up from a table.
+void native_reverb_set_params(NativeReverb *p_reverb, const ReverbParameters *p_params);
+
+// the coefficients the reverb currently runs with, e.g. to check the incremental updates against a full computation
+const NativeReverbCoefficients *native_reverb_coefficients(const NativeReverb *p_reverb);
+
+// clears the delay memory and filter states
+void native_reverb_reset(NativeReverb *p_reverb);
+
+// processes p_frames interleaved frames of p_in_channels into p_out_channels, dry and wet signal mixed by WetDryMix.
+//	p_output is overwritten.
+void native_reverb_process(NativeReverb *p_reverb, const float *p_input, float *p_output, uint32_t p_frames);
+
+size_t native_reverb_bytes_in_use(const NativeReverb *p_reverb);
+
+// number of frames native_reverb_capture_response needs for the whole decay of p_params, at most NATIVE_REVERB_MAX_RESPONSE
+const float NATIVE_REVERB_MAX_RESPONSE = 15.0f;		// seconds
+uint32_t native_reverb_response_length(const ReverbParameters *p_params, unsigned int p_sample_rate);
+
+// renders the wet impulse response of p_params for a mono input into p_response, p_frames interleaved frames of
+//	p_out_channels (2 or 6). WetDryMix is ignored, the response is the wet signal at full level. Returns the number of
+//	frames that are actually audible, the rest of p_response is (nearly) silent.
+uint32_t native_reverb_capture_response(const ReverbParameters *p_params, unsigned int p_sample_rate, unsigned int p_out_channels,
+										float *p_response, uint32_t p_frames);
+
+// the inner loops come in scalar, SSE2, AVX2 and AVX-512 variants. By default native_reverb_create uses the widest set
+//	this CPU supports; native_reverb_select_kernels ("scalar", "sse2", "avx2" or "avx512") overrides that for the reverbs
+//	created afterwards, e.g. to compare the variants. Returns false when the set is unknown or not supported here.
+bool native_reverb_select_kernels(const char *p_name);
+
+// display name of the set native_reverb_create currently uses, e.g. "AVX2"
+const char *native_reverb_kernels_name();
+
+// storage of the pre-delay line and the feedback network lines, which hold nearly all of the delay memory (the diffusion
+//	allpasses and the rear delay are a few KB and stay float). The 16 bit formats halve the memory a reverb streams
+//	through, at the cost of precision:
+//	- half floats keep 11 significant bits at any level, the error stays about 66 dB below the signal
+//	- int16 has a fixed step of NATIVE_REVERB_INT16_RANGE / 32768 (-90 dBFS), quiet tails lose more of their resolution
+enum NativeDelayFormat {
+	NativeDelayFormat_Float32 = 0,
+	NativeDelayFormat_Float16,
+	NativeDelayFormat_Int16,
+	NativeDelayFormat_Count
+};
+
+// selects the format ("float", "half" or "int16") of the reverbs created afterwards, like native_reverb_select_kernels.
+//	Returns false when the name is unknown. The impulse responses of the convolution mode are always captured in float.
+bool native_reverb_select_delay_format(const char *p_name);
+
+const char *native_reverb_delay_format_name();
+
+#endif // FAUDIOFILTERDEMO_NATIVE_REVERB_H
@@ -0,0 +1,248 @@
+#include "native_reverb_kernels.h"
+
+// AVX2 / FMA kernels: eight samples per instruction, the network reads its eight lines with one gather and writes a
+//	frame with one store. Half floats are converted with F16C, which every AVX2 CPU has. There is no 16 bit gather: the 16
+//	bit lines are gathered as 32 bit values starting at each element and the upper halves dropped.
+
+#if defined(NATIVE_REVERB_X86) && ((defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)) || (defined(_MSC_VER) && _MSC_VER >= 1800))
+
+#include <immintrin.h>
+
+static void native_mac_avx2(float *p_output, const float *p_input, uint32_t p_count, float p_gain)
+{
+	__m256 gain = _mm256_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		__m256 out = _mm256_loadu_ps(p_output + idx);
+		_mm256_storeu_ps(p_output + idx, _mm256_fmadd_ps(gain, _mm256_loadu_ps(p_input + idx), out));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * p_input[idx];
+	}
+}
+
+static void native_mac_half_avx2(float *p_output, const uint16_t *p_input, uint32_t p_count, float p_gain)
+{
+	__m256 gain = _mm256_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		__m256 input = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (p_input + idx)));
+		_mm256_storeu_ps(p_output + idx, _mm256_fmadd_ps(gain, input, _mm256_loadu_ps(p_output + idx)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_half_to_float(p_input[idx]);
+	}
+}
+
+static void native_mac_int16_avx2(float *p_output, const int16_t *p_input, uint32_t p_count, float p_gain)
+{
+	__m256 gain = _mm256_set1_ps(p_gain);
+	__m256 scale = _mm256_set1_ps(1.0f / NATIVE_REVERB_INT16_SCALE);
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		__m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (p_input + idx)));
+		__m256 input = _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale);
+		_mm256_storeu_ps(p_output + idx, _mm256_fmadd_ps(gain, input, _mm256_loadu_ps(p_output + idx)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_int16_to_float(p_input[idx]);
+	}
+}
+
+static void native_allpass_avx2(float *p_samples, float *p_buffer, uint32_t p_count, float p_gain)
+{
+	__m256 gain = _mm256_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		__m256 delayed = _mm256_loadu_ps(p_buffer + idx);
+		__m256 input = _mm256_loadu_ps(p_samples + idx);
+
+		_mm256_storeu_ps(p_samples + idx, _mm256_fnmadd_ps(gain, input, delayed));
+		_mm256_storeu_ps(p_buffer + idx, _mm256_fmadd_ps(gain, delayed, input));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		float delayed = p_buffer[idx];
+		float input = p_samples[idx];
+
+		p_samples[idx] = delayed - p_gain * input;
+		p_buffer[idx] = input + p_gain * delayed;
+	}
+}
+
+static void native_cmac_avx2(float *p_re, float *p_im, const float *p_a_re, const float *p_a_im, const float *p_b_re, const float *p_b_im, uint32_t p_count)
+{
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		__m256 a_re = _mm256_loadu_ps(p_a_re + idx);
+		__m256 a_im = _mm256_loadu_ps(p_a_im + idx);
+		__m256 b_re = _mm256_loadu_ps(p_b_re + idx);
+		__m256 b_im = _mm256_loadu_ps(p_b_im + idx);
+
+		__m256 re = _mm256_fnmadd_ps(a_im, b_im, _mm256_fmadd_ps(a_re, b_re, _mm256_loadu_ps(p_re + idx)));
+		__m256 im = _mm256_fmadd_ps(a_im, b_re, _mm256_fmadd_ps(a_re, b_im, _mm256_loadu_ps(p_im + idx)));
+
+		_mm256_storeu_ps(p_re + idx, re);
+		_mm256_storeu_ps(p_im + idx, im);
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_re[idx] += p_a_re[idx] * p_b_re[idx] - p_a_im[idx] * p_b_im[idx];
+		p_im[idx] += p_a_re[idx] * p_b_im[idx] + p_a_im[idx] * p_b_re[idx];
+	}
+}
+
+// reads the elements p_index of the lines
+static inline __m256 native_gather_avx2(const float *p_lines, __m256i p_index)
+{
+	return _mm256_i32gather_ps(p_lines, p_index, 4);
+}
+
+static inline __m256 native_gather_avx2(const uint16_t *p_lines, __m256i p_index)
+{
+	__m256i words = _mm256_and_si256(_mm256_i32gather_epi32((const int *) p_lines, p_index, 2), _mm256_set1_epi32(0xffff));
+	return _mm256_cvtph_ps(_mm_packus_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1)));
+}
+
+static inline __m256 native_gather_avx2(const int16_t *p_lines, __m256i p_index)
+{
+	__m256i words = _mm256_i32gather_epi32((const int *) p_lines, p_index, 2);
+	__m256i samples = _mm256_srai_epi32(_mm256_slli_epi32(words, 16), 16);
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_set1_ps(1.0f / NATIVE_REVERB_INT16_SCALE));
+}
+
+// writes the eight lines of one frame
+static inline void native_store_frame_avx2(float *p_frame, __m256 p_value)
+{
+	_mm256_storeu_ps(p_frame, p_value);
+}
+
+static inline void native_store_frame_avx2(uint16_t *p_frame, __m256 p_value)
+{
+	_mm_storeu_si128((__m128i *) p_frame, _mm256_cvtps_ph(p_value, _MM_FROUND_TO_NEAREST_INT));
+}
+
+static inline void native_store_frame_avx2(int16_t *p_frame, __m256 p_value)
+{
+	__m256 scaled = _mm256_mul_ps(p_value, _mm256_set1_ps(NATIVE_REVERB_INT16_SCALE));
+	scaled = _mm256_min_ps(_mm256_max_ps(scaled, _mm256_set1_ps(-32768.0f)), _mm256_set1_ps(32767.0f));
+
+	__m256i samples = _mm256_cvtps_epi32(scaled);
+	_mm_storeu_si128((__m128i *) p_frame, _mm_packs_epi32(_mm256_castsi256_si128(samples), _mm256_extracti128_si256(samples, 1)));
+}
+
+template <typename T>
+static void native_network_avx2_t(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	T *lines = (T *) p_network->lines;
+	uint32_t line_mask = p_network->line_mask;
+
+	__m256i length = _mm256_loadu_si256((const __m256i *) p_coefs->line_length);
+	__m256i mask = _mm256_set1_epi32((int) line_mask);
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	__m256 state = _mm256_loadu_ps(p_network->line_state);
+	__m256 gain = _mm256_loadu_ps(p_coefs->line_gain);
+	__m256 hf = _mm256_loadu_ps(p_coefs->line_hf);
+	__m256 damping = _mm256_set1_ps(p_coefs->damping_lp);
+	__m256 denormal = _mm256_set1_ps(NATIVE_REVERB_DENORMAL);
+	__m256 density = _mm256_set1_ps(p_coefs->density);
+	__m256 sign = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+
+	__m128 low_state = _mm_loadu_ps(p_network->low_state);
+	__m128 low_lp = _mm_set1_ps(p_coefs->low_lp);
+	__m128 low_gain = _mm_set1_ps(p_coefs->low_gain - 1.0f);
+	__m128 reverb_gain = _mm_set1_ps(p_coefs->reverb_gain);
+	__m128 low_denormal = _mm_set1_ps(NATIVE_REVERB_DENORMAL);
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		uint32_t position = p_network->line_position;
+
+		// read, damp and attenuate every line
+		__m256i row = _mm256_and_si256(_mm256_sub_epi32(_mm256_set1_epi32((int) position), length), mask);
+		__m256 delayed = native_gather_avx2(lines, _mm256_add_epi32(_mm256_slli_epi32(row, 3), lane));
+
+		state = _mm256_add_ps(_mm256_fmadd_ps(damping, _mm256_sub_ps(delayed, state), state), denormal);
+		__m256 y = _mm256_mul_ps(gain, _mm256_fmadd_ps(hf, _mm256_sub_ps(delayed, state), state));
+
+		__m128 y_lo = _mm256_castps256_ps128(y);
+		__m128 y_hi = _mm256_extractf128_ps(y, 1);
+
+		// feedback and input
+		__m128 sum = _mm_add_ps(y_lo, y_hi);
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+		__m256 feedback = _mm256_mul_ps(density, _mm256_broadcastss_ps(sum));
+		__m256 input = _mm256_mul_ps(sign, _mm256_set1_ps(p_input[frame]));
+
+		native_store_frame_avx2(lines + (position & line_mask) * NATIVE_REVERB_LINES, _mm256_add_ps(_mm256_sub_ps(y, feedback), input));
+
+		p_network->line_position = position + 1;
+
+		// taps: (y0 - y2 + y4 - y6, y1 - y3 + y5 - y7, y0 + y3 - y4 - y7, y1 + y2 - y5 - y6)
+		__m128 t = _mm_add_ps(y_lo, y_hi);
+		__m128 u = _mm_sub_ps(t, _mm_movehl_ps(t, t));
+		__m128 d = _mm_sub_ps(y_lo, y_hi);
+		__m128 v = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 1, 2, 3)));
+		__m128 late = _mm_movelh_ps(u, v);
+
+		low_state = _mm_add_ps(_mm_fmadd_ps(low_lp, _mm_sub_ps(late, low_state), low_state), low_denormal);
+		_mm_storeu_ps(p_output + frame * 4, _mm_mul_ps(reverb_gain, _mm_fmadd_ps(low_gain, low_state, late)));
+	}
+
+	_mm256_storeu_ps(p_network->line_state, state);
+	_mm_storeu_ps(p_network->low_state, low_state);
+}
+
+static void native_network_avx2(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_avx2_t<float>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+static void native_network_half_avx2(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_avx2_t<uint16_t>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+static void native_network_int16_avx2(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_avx2_t<int16_t>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+const NativeReverbKernels native_reverb_kernels_avx2 = {
+	"AVX2",
+	native_mac_avx2,
+	native_allpass_avx2,
+	native_cmac_avx2,
+	native_network_avx2,
+	native_mac_half_avx2,
+	native_mac_int16_avx2,
+	native_network_half_avx2,
+	native_network_int16_avx2
+};
+
+#else
+
+const NativeReverbKernels native_reverb_kernels_avx2 = { "AVX2", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+
+#endif
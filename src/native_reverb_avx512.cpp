@@ -0,0 +1,251 @@
+#include "native_reverb_kernels.h"
+
+// AVX-512 kernels: sixteen samples per instruction with masked tails. The network runs two frames per iteration, which
+//	works because every line is at least two frames long: the second frame never reads what the first one writes. Both
+//	frames are read with one gather and, as consecutive rows of the interleaved lines, written with one store.
+//	The 16 bit delay storage only has its own mac here, its network is the AVX2 one: a frame of 16 bit lines is just 128
+//	bits and the masked 16 bit loads and stores would need AVX512BW.
+
+#if defined(NATIVE_REVERB_X86) && ((defined(__AVX512F__) && defined(__AVX512VL__)) || (defined(_MSC_VER) && _MSC_VER >= 1911))
+
+#include <immintrin.h>
+
+// the 512 bit cast / insert intrinsics of some GCC versions start from an "undefined" register and trip these warnings
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+static void native_mac_avx512(float *p_output, const float *p_input, uint32_t p_count, float p_gain)
+{
+	__m512 gain = _mm512_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 16 <= p_count; idx += 16)
+	{
+		__m512 out = _mm512_loadu_ps(p_output + idx);
+		_mm512_storeu_ps(p_output + idx, _mm512_fmadd_ps(gain, _mm512_loadu_ps(p_input + idx), out));
+	}
+
+	if (idx < p_count)
+	{
+		__mmask16 tail = (__mmask16) ((1u << (p_count - idx)) - 1);
+		__m512 out = _mm512_maskz_loadu_ps(tail, p_output + idx);
+		_mm512_mask_storeu_ps(p_output + idx, tail, _mm512_fmadd_ps(gain, _mm512_maskz_loadu_ps(tail, p_input + idx), out));
+	}
+}
+
+static void native_mac_half_avx512(float *p_output, const uint16_t *p_input, uint32_t p_count, float p_gain)
+{
+	__m512 gain = _mm512_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 16 <= p_count; idx += 16)
+	{
+		__m512 input = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) (p_input + idx)));
+		_mm512_storeu_ps(p_output + idx, _mm512_fmadd_ps(gain, input, _mm512_loadu_ps(p_output + idx)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_half_to_float(p_input[idx]);
+	}
+}
+
+static void native_mac_int16_avx512(float *p_output, const int16_t *p_input, uint32_t p_count, float p_gain)
+{
+	__m512 gain = _mm512_set1_ps(p_gain);
+	__m512 scale = _mm512_set1_ps(1.0f / NATIVE_REVERB_INT16_SCALE);
+	uint32_t idx = 0;
+
+	for (; idx + 16 <= p_count; idx += 16)
+	{
+		__m512i samples = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *) (p_input + idx)));
+		__m512 input = _mm512_mul_ps(_mm512_cvtepi32_ps(samples), scale);
+		_mm512_storeu_ps(p_output + idx, _mm512_fmadd_ps(gain, input, _mm512_loadu_ps(p_output + idx)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_int16_to_float(p_input[idx]);
+	}
+}
+
+static void native_allpass_avx512(float *p_samples, float *p_buffer, uint32_t p_count, float p_gain)
+{
+	__m512 gain = _mm512_set1_ps(p_gain);
+
+	for (uint32_t idx = 0; idx < p_count; idx += 16)
+	{
+		__mmask16 valid = (p_count - idx >= 16) ? (__mmask16) 0xffff : (__mmask16) ((1u << (p_count - idx)) - 1);
+		__m512 delayed = _mm512_maskz_loadu_ps(valid, p_buffer + idx);
+		__m512 input = _mm512_maskz_loadu_ps(valid, p_samples + idx);
+
+		_mm512_mask_storeu_ps(p_samples + idx, valid, _mm512_fnmadd_ps(gain, input, delayed));
+		_mm512_mask_storeu_ps(p_buffer + idx, valid, _mm512_fmadd_ps(gain, delayed, input));
+	}
+}
+
+static void native_cmac_avx512(float *p_re, float *p_im, const float *p_a_re, const float *p_a_im, const float *p_b_re, const float *p_b_im, uint32_t p_count)
+{
+	for (uint32_t idx = 0; idx < p_count; idx += 16)
+	{
+		__mmask16 valid = (p_count - idx >= 16) ? (__mmask16) 0xffff : (__mmask16) ((1u << (p_count - idx)) - 1);
+		__m512 a_re = _mm512_maskz_loadu_ps(valid, p_a_re + idx);
+		__m512 a_im = _mm512_maskz_loadu_ps(valid, p_a_im + idx);
+		__m512 b_re = _mm512_maskz_loadu_ps(valid, p_b_re + idx);
+		__m512 b_im = _mm512_maskz_loadu_ps(valid, p_b_im + idx);
+
+		__m512 re = _mm512_fnmadd_ps(a_im, b_im, _mm512_fmadd_ps(a_re, b_re, _mm512_maskz_loadu_ps(valid, p_re + idx)));
+		__m512 im = _mm512_fmadd_ps(a_im, b_re, _mm512_fmadd_ps(a_re, b_im, _mm512_maskz_loadu_ps(valid, p_im + idx)));
+
+		_mm512_mask_storeu_ps(p_re + idx, valid, re);
+		_mm512_mask_storeu_ps(p_im + idx, valid, im);
+	}
+}
+
+// network state of one frame, kept in registers across the block
+struct NativeNetworkAvx512
+{
+	__m256 state;
+	__m256 gain;
+	__m256 hf;
+	__m256 damping;
+	__m256 denormal;
+	__m256 density;
+	__m256 sign;
+
+	__m128 low_state;
+	__m128 low_lp;
+	__m128 low_gain;
+	__m128 reverb_gain;
+};
+
+// damps and attenuates the delayed samples of one frame, returns the line outputs and the value to write back
+static inline __m256 native_network_step(NativeNetworkAvx512 &p_regs, __m256 p_delayed, float p_input, __m256 &p_write)
+{
+	p_regs.state = _mm256_add_ps(_mm256_fmadd_ps(p_regs.damping, _mm256_sub_ps(p_delayed, p_regs.state), p_regs.state), p_regs.denormal);
+	__m256 y = _mm256_mul_ps(p_regs.gain, _mm256_fmadd_ps(p_regs.hf, _mm256_sub_ps(p_delayed, p_regs.state), p_regs.state));
+
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(y), _mm256_extractf128_ps(y, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+	__m256 feedback = _mm256_mul_ps(p_regs.density, _mm256_broadcastss_ps(sum));
+	p_write = _mm256_add_ps(_mm256_sub_ps(y, feedback), _mm256_mul_ps(p_regs.sign, _mm256_set1_ps(p_input)));
+
+	return y;
+}
+
+// taps (y0 - y2 + y4 - y6, y1 - y3 + y5 - y7, y0 + y3 - y4 - y7, y1 + y2 - y5 - y6) and the low shelf
+static inline void native_network_taps(NativeNetworkAvx512 &p_regs, __m256 p_y, float *p_output)
+{
+	__m128 y_lo = _mm256_castps256_ps128(p_y);
+	__m128 y_hi = _mm256_extractf128_ps(p_y, 1);
+
+	__m128 t = _mm_add_ps(y_lo, y_hi);
+	__m128 u = _mm_sub_ps(t, _mm_movehl_ps(t, t));
+	__m128 d = _mm_sub_ps(y_lo, y_hi);
+	__m128 v = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 1, 2, 3)));
+	__m128 late = _mm_movelh_ps(u, v);
+
+	p_regs.low_state = _mm_add_ps(_mm_fmadd_ps(p_regs.low_lp, _mm_sub_ps(late, p_regs.low_state), p_regs.low_state), _mm256_castps256_ps128(p_regs.denormal));
+	_mm_storeu_ps(p_output, _mm_mul_ps(p_regs.reverb_gain, _mm_fmadd_ps(p_regs.low_gain, p_regs.low_state, late)));
+}
+
+static void native_network_avx512(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	float *lines = (float *) p_network->lines;
+	uint32_t line_mask = p_network->line_mask;
+
+	NativeNetworkAvx512 regs;
+	regs.state = _mm256_loadu_ps(p_network->line_state);
+	regs.gain = _mm256_loadu_ps(p_coefs->line_gain);
+	regs.hf = _mm256_loadu_ps(p_coefs->line_hf);
+	regs.damping = _mm256_set1_ps(p_coefs->damping_lp);
+	regs.denormal = _mm256_set1_ps(NATIVE_REVERB_DENORMAL);
+	regs.density = _mm256_set1_ps(p_coefs->density);
+	regs.sign = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+	regs.low_state = _mm_loadu_ps(p_network->low_state);
+	regs.low_lp = _mm_set1_ps(p_coefs->low_lp);
+	regs.low_gain = _mm_set1_ps(p_coefs->low_gain - 1.0f);
+	regs.reverb_gain = _mm_set1_ps(p_coefs->reverb_gain);
+
+	// lanes 0 - 7 address the lines of the first frame, lanes 8 - 15 those of the second
+	__m256i length8 = _mm256_loadu_si256((const __m256i *) p_coefs->line_length);
+	__m512i length = _mm512_inserti64x4(_mm512_castsi256_si512(length8), length8, 1);
+	__m512i step = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+	__m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7);
+	__m512i mask = _mm512_set1_epi32((int) line_mask);
+
+	uint32_t frame = 0;
+
+	for (; frame + 2 <= p_frames; frame += 2)
+	{
+		uint32_t position = p_network->line_position;
+
+		__m512i now = _mm512_add_epi32(_mm512_set1_epi32((int) position), step);
+		__m512i row = _mm512_and_si512(_mm512_sub_epi32(now, length), mask);
+		__m512 delayed = _mm512_i32gather_ps(_mm512_add_epi32(_mm512_slli_epi32(row, 3), lane), lines, 4);
+
+		__m256 write[2];
+		__m256 y0 = native_network_step(regs, _mm512_castps512_ps256(delayed), p_input[frame], write[0]);
+		__m256 y1 = native_network_step(regs, _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(delayed), 1)), p_input[frame + 1], write[1]);
+
+		// the two rows are adjacent unless the first one is the last row of the lines
+		uint32_t first = position & line_mask;
+
+		if (first != line_mask)
+		{
+			__m512 both = _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(write[0])), _mm256_castps_pd(write[1]), 1));
+			_mm512_storeu_ps(lines + first * NATIVE_REVERB_LINES, both);
+		}
+		else
+		{
+			_mm256_storeu_ps(lines + first * NATIVE_REVERB_LINES, write[0]);
+			_mm256_storeu_ps(lines, write[1]);
+		}
+
+		p_network->line_position = position + 2;
+
+		native_network_taps(regs, y0, p_output + frame * 4);
+		native_network_taps(regs, y1, p_output + frame * 4 + 4);
+	}
+
+	if (frame < p_frames)
+	{
+		uint32_t position = p_network->line_position;
+
+		__m512i row = _mm512_and_si512(_mm512_sub_epi32(_mm512_set1_epi32((int) position), length), mask);
+		__m512 delayed = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0x00ff, _mm512_add_epi32(_mm512_slli_epi32(row, 3), lane), lines, 4);
+
+		__m256 write;
+		__m256 y = native_network_step(regs, _mm512_castps512_ps256(delayed), p_input[frame], write);
+
+		_mm256_storeu_ps(lines + (position & line_mask) * NATIVE_REVERB_LINES, write);
+		p_network->line_position = position + 1;
+
+		native_network_taps(regs, y, p_output + frame * 4);
+	}
+
+	_mm256_storeu_ps(p_network->line_state, regs.state);
+	_mm_storeu_ps(p_network->low_state, regs.low_state);
+}
+
+const NativeReverbKernels native_reverb_kernels_avx512 = {
+	"AVX-512",
+	native_mac_avx512,
+	native_allpass_avx512,
+	native_cmac_avx512,
+	native_network_avx512,
+	native_mac_half_avx512,
+	native_mac_int16_avx512,
+	nullptr,
+	nullptr
+};
+
+#else
+
+const NativeReverbKernels native_reverb_kernels_avx512 = { "AVX-512", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef FAUDIOFILTERDEMO_NATIVE_REVERB_KERNELS_H
+#define FAUDIOFILTERDEMO_NATIVE_REVERB_KERNELS_H
+
+#include "native_reverb.h"
+
+#include <math.h>
+#include <string.h>
+
+// inner loops of the native reverb, one set per instruction set. native_reverb.cpp picks the widest set the CPU (and OS)
+//	supports when a reverb is created; every set is compiled in its own translation unit with the matching compiler flags
+//	and is never called on a CPU that lacks them.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NATIVE_REVERB_X86
+#endif
+
+// tiny offset added to the recursive filter states, keeps decaying tails out of the (slow) denormal range
+const float NATIVE_REVERB_DENORMAL = 1e-20f;
+
+// full scale of the int16 delay storage: the lines peak around 0.5 with the presets at full volume, louder values
+//	saturate. One step is 3e-5, about -90 dBFS.
+const float NATIVE_REVERB_INT16_RANGE = 1.0f;
+const float NATIVE_REVERB_INT16_SCALE = 32768.0f / NATIVE_REVERB_INT16_RANGE;
+
+// conversions of the reduced precision delay storage, the vector kernels convert with the same rounding:
+//	- half floats round to nearest even, like the F16C instructions
+//	- int16 saturates and rounds to nearest (the default mode of cvtps2dq), truncating biased the feedback toward zero
+//	and cut the tails short
+//	The kernel sets still only match within a tolerance, not bit for bit: FMA contraction and the order of the vector
+//	sums change the float math around the delay lines, and the 16 bit storage amplifies that to up to 3.7e-3 per sample
+//	with half lines.
+inline uint16_t native_float_to_half(float p_value)
+{
+	uint32_t bits;
+	memcpy(&bits, &p_value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	// too large for a half (after rounding) or NaN
+	if (magnitude >= 0x477ff000)
+		return (uint16_t) (sign | ((magnitude > 0x7f800000) ? 0x7e00 : 0x7c00));
+
+	// below the smallest normal half: subnormal steps of 2^-24
+	if (magnitude < 0x38800000)
+	{
+		float value;
+		memcpy(&value, &magnitude, sizeof(value));
+		return (uint16_t) (sign | (uint32_t) lrintf(value * 16777216.0f));
+	}
+
+	// rebias the exponent and round the 13 dropped mantissa bits
+	uint32_t result = magnitude - 0x38000000;
+	result += 0x0fff + ((result >> 13) & 1);
+	return (uint16_t) (sign | (result >> 13));
+}
+
+inline float native_half_to_float(uint16_t p_value)
+{
+	uint32_t sign = (uint32_t) (p_value & 0x8000) << 16;
+	uint32_t exponent = (p_value >> 10) & 0x1f;
+	uint32_t mantissa = p_value & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0)
+	{
+		float result = mantissa * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+inline int16_t native_float_to_int16(float p_value)
+{
+	float scaled = fminf(fmaxf(p_value * NATIVE_REVERB_INT16_SCALE, -32768.0f), 32767.0f);
+	return (int16_t) lrintf(scaled);
+}
+
+inline float native_int16_to_float(int16_t p_value)
+{
+	return p_value * (1.0f / NATIVE_REVERB_INT16_SCALE);
+}
+
+// element access for the loops that are written once for every storage type
+inline float native_delay_load(const float *p_value) { return *p_value; }
+inline float native_delay_load(const uint16_t *p_value) { return native_half_to_float(*p_value); }
+inline float native_delay_load(const int16_t *p_value) { return native_int16_to_float(*p_value); }
+
+inline void native_delay_store(float *p_value, float p_sample) { *p_value = p_sample; }
+inline void native_delay_store(uint16_t *p_value, float p_sample) { *p_value = native_float_to_half(p_sample); }
+inline void native_delay_store(int16_t *p_value, float p_sample) { *p_value = native_float_to_int16(p_sample); }
+
+// state of the feedback delay network. The lines are interleaved, frame by frame: lines[frame * NATIVE_REVERB_LINES + line],
+//	so writing one frame is a single vector store and reading is one gather. They are stored as float, uint16_t half floats
+//	or int16_t, see NativeDelayFormat; the 16 bit lines have one spare element at the end so a 32 bit gather of the last
+//	one stays inside the allocation.
+struct NativeNetwork
+{
+	void *	 lines;
+	uint32_t line_mask;				// frames per line - 1
+	uint32_t line_position;
+	float	 line_state[NATIVE_REVERB_LINES];
+	float	 low_state[4];
+};
+
+struct NativeReverbKernels
+{
+	const char *name;
+
+	// p_output[i] += p_gain * p_input[i]
+	void (*mac)(float *p_output, const float *p_input, uint32_t p_count, float p_gain);
+
+	// Schroeder allpass over p_count samples in place, against a stretch of the delay buffer that does not wrap. Only
+	//	valid for p_count <= the delay length, then no sample depends on another one of the same call.
+	void (*allpass)(float *p_samples, float *p_buffer, uint32_t p_count, float p_gain);
+
+	// complex multiply-accumulate on split spectra, (p_re, p_im)[i] += (p_a_re, p_a_im)[i] * (p_b_re, p_b_im)[i]. Used by
+	//	the partitioned convolution, see native_convolution.h.
+	void (*cmac)(float *p_re, float *p_im, const float *p_a_re, const float *p_a_im, const float *p_b_re, const float *p_b_im, uint32_t p_count);
+
+	// runs the network for p_frames frames of mono input and writes the late reverb for front left / right and rear
+	//	left / right, 4 interleaved channels, after the low shelf and ReverbGain
+	void (*network)(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames);
+
+	// the same mac and network with the delay memory stored as half floats or int16. Null when the set has no version of
+	//	its own, the reverb uses the one of the next narrower set then.
+	void (*mac_half)(float *p_output, const uint16_t *p_input, uint32_t p_count, float p_gain);
+	void (*mac_int16)(float *p_output, const int16_t *p_input, uint32_t p_count, float p_gain);
+	void (*network_half)(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames);
+	void (*network_int16)(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames);
+};
+
+// function pointers are null when the compiler can't build that set
+extern const NativeReverbKernels native_reverb_kernels_scalar;
+extern const NativeReverbKernels native_reverb_kernels_sse2;
+extern const NativeReverbKernels native_reverb_kernels_avx2;
+extern const NativeReverbKernels native_reverb_kernels_avx512;
+
+// the set native_reverb_create picks, see native_reverb_select_kernels. The reduced precision entries are always filled in.
+const NativeReverbKernels *native_reverb_kernels();
+
+#endif // FAUDIOFILTERDEMO_NATIVE_REVERB_KERNELS_H
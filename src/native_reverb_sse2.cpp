@@ -0,0 +1,217 @@
+#include "native_reverb_kernels.h"
+
+// SSE2 kernels: four samples per instruction, the eight network lines in two registers. SSE2 can't convert half floats,
+//	that storage uses the scalar kernels.
+
+#if defined(NATIVE_REVERB_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+
+#include <emmintrin.h>
+
+static void native_mac_sse2(float *p_output, const float *p_input, uint32_t p_count, float p_gain)
+{
+	__m128 gain = _mm_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 4 <= p_count; idx += 4)
+	{
+		__m128 out = _mm_loadu_ps(p_output + idx);
+		_mm_storeu_ps(p_output + idx, _mm_add_ps(out, _mm_mul_ps(gain, _mm_loadu_ps(p_input + idx))));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * p_input[idx];
+	}
+}
+
+static void native_mac_int16_sse2(float *p_output, const int16_t *p_input, uint32_t p_count, float p_gain)
+{
+	__m128 gain = _mm_set1_ps(p_gain);
+	__m128 scale = _mm_set1_ps(1.0f / NATIVE_REVERB_INT16_SCALE);
+	uint32_t idx = 0;
+
+	for (; idx + 8 <= p_count; idx += 8)
+	{
+		// sign extend by unpacking every sample into the upper half of a 32 bit lane
+		__m128i samples = _mm_loadu_si128((const __m128i *) (p_input + idx));
+		__m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), scale);
+		__m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)), scale);
+
+		_mm_storeu_ps(p_output + idx, _mm_add_ps(_mm_loadu_ps(p_output + idx), _mm_mul_ps(gain, lo)));
+		_mm_storeu_ps(p_output + idx + 4, _mm_add_ps(_mm_loadu_ps(p_output + idx + 4), _mm_mul_ps(gain, hi)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_output[idx] += p_gain * native_int16_to_float(p_input[idx]);
+	}
+}
+
+static void native_allpass_sse2(float *p_samples, float *p_buffer, uint32_t p_count, float p_gain)
+{
+	__m128 gain = _mm_set1_ps(p_gain);
+	uint32_t idx = 0;
+
+	for (; idx + 4 <= p_count; idx += 4)
+	{
+		__m128 delayed = _mm_loadu_ps(p_buffer + idx);
+		__m128 input = _mm_loadu_ps(p_samples + idx);
+
+		_mm_storeu_ps(p_samples + idx, _mm_sub_ps(delayed, _mm_mul_ps(gain, input)));
+		_mm_storeu_ps(p_buffer + idx, _mm_add_ps(input, _mm_mul_ps(gain, delayed)));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		float delayed = p_buffer[idx];
+		float input = p_samples[idx];
+
+		p_samples[idx] = delayed - p_gain * input;
+		p_buffer[idx] = input + p_gain * delayed;
+	}
+}
+
+static void native_cmac_sse2(float *p_re, float *p_im, const float *p_a_re, const float *p_a_im, const float *p_b_re, const float *p_b_im, uint32_t p_count)
+{
+	uint32_t idx = 0;
+
+	for (; idx + 4 <= p_count; idx += 4)
+	{
+		__m128 a_re = _mm_loadu_ps(p_a_re + idx);
+		__m128 a_im = _mm_loadu_ps(p_a_im + idx);
+		__m128 b_re = _mm_loadu_ps(p_b_re + idx);
+		__m128 b_im = _mm_loadu_ps(p_b_im + idx);
+
+		__m128 re = _mm_sub_ps(_mm_mul_ps(a_re, b_re), _mm_mul_ps(a_im, b_im));
+		__m128 im = _mm_add_ps(_mm_mul_ps(a_re, b_im), _mm_mul_ps(a_im, b_re));
+
+		_mm_storeu_ps(p_re + idx, _mm_add_ps(_mm_loadu_ps(p_re + idx), re));
+		_mm_storeu_ps(p_im + idx, _mm_add_ps(_mm_loadu_ps(p_im + idx), im));
+	}
+
+	for (; idx < p_count; ++idx)
+	{
+		p_re[idx] += p_a_re[idx] * p_b_re[idx] - p_a_im[idx] * p_b_im[idx];
+		p_im[idx] += p_a_re[idx] * p_b_im[idx] + p_a_im[idx] * p_b_re[idx];
+	}
+}
+
+// writes the eight lines of one frame
+static inline void native_store_frame_sse2(float *p_frame, __m128 p_lo, __m128 p_hi)
+{
+	_mm_storeu_ps(p_frame, p_lo);
+	_mm_storeu_ps(p_frame + 4, p_hi);
+}
+
+static inline void native_store_frame_sse2(int16_t *p_frame, __m128 p_lo, __m128 p_hi)
+{
+	__m128 scale = _mm_set1_ps(NATIVE_REVERB_INT16_SCALE);
+	__m128 min = _mm_set1_ps(-32768.0f);
+	__m128 max = _mm_set1_ps(32767.0f);
+
+	__m128i lo = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(p_lo, scale), min), max));
+	__m128i hi = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(p_hi, scale), min), max));
+
+	_mm_storeu_si128((__m128i *) p_frame, _mm_packs_epi32(lo, hi));
+}
+
+template <typename T>
+static void native_network_sse2_t(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	T *lines = (T *) p_network->lines;
+	uint32_t line_mask = p_network->line_mask;
+	const uint32_t *length = p_coefs->line_length;
+
+	__m128 state_lo = _mm_loadu_ps(p_network->line_state);
+	__m128 state_hi = _mm_loadu_ps(p_network->line_state + 4);
+	__m128 gain_lo = _mm_loadu_ps(p_coefs->line_gain);
+	__m128 gain_hi = _mm_loadu_ps(p_coefs->line_gain + 4);
+	__m128 hf_lo = _mm_loadu_ps(p_coefs->line_hf);
+	__m128 hf_hi = _mm_loadu_ps(p_coefs->line_hf + 4);
+	__m128 damping = _mm_set1_ps(p_coefs->damping_lp);
+	__m128 denormal = _mm_set1_ps(NATIVE_REVERB_DENORMAL);
+	__m128 sign = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+
+	__m128 low_state = _mm_loadu_ps(p_network->low_state);
+	__m128 low_lp = _mm_set1_ps(p_coefs->low_lp);
+	__m128 low_gain = _mm_set1_ps(p_coefs->low_gain - 1.0f);
+	__m128 reverb_gain = _mm_set1_ps(p_coefs->reverb_gain);
+
+	for (uint32_t frame = 0; frame < p_frames; ++frame)
+	{
+		uint32_t position = p_network->line_position;
+
+		// read, damp and attenuate every line
+		__m128 delayed_lo = _mm_setr_ps(
+			native_delay_load(lines + ((position - length[0]) & line_mask) * NATIVE_REVERB_LINES + 0),
+			native_delay_load(lines + ((position - length[1]) & line_mask) * NATIVE_REVERB_LINES + 1),
+			native_delay_load(lines + ((position - length[2]) & line_mask) * NATIVE_REVERB_LINES + 2),
+			native_delay_load(lines + ((position - length[3]) & line_mask) * NATIVE_REVERB_LINES + 3));
+		__m128 delayed_hi = _mm_setr_ps(
+			native_delay_load(lines + ((position - length[4]) & line_mask) * NATIVE_REVERB_LINES + 4),
+			native_delay_load(lines + ((position - length[5]) & line_mask) * NATIVE_REVERB_LINES + 5),
+			native_delay_load(lines + ((position - length[6]) & line_mask) * NATIVE_REVERB_LINES + 6),
+			native_delay_load(lines + ((position - length[7]) & line_mask) * NATIVE_REVERB_LINES + 7));
+
+		state_lo = _mm_add_ps(_mm_add_ps(state_lo, _mm_mul_ps(damping, _mm_sub_ps(delayed_lo, state_lo))), denormal);
+		state_hi = _mm_add_ps(_mm_add_ps(state_hi, _mm_mul_ps(damping, _mm_sub_ps(delayed_hi, state_hi))), denormal);
+
+		__m128 y_lo = _mm_mul_ps(gain_lo, _mm_add_ps(state_lo, _mm_mul_ps(hf_lo, _mm_sub_ps(delayed_lo, state_lo))));
+		__m128 y_hi = _mm_mul_ps(gain_hi, _mm_add_ps(state_hi, _mm_mul_ps(hf_hi, _mm_sub_ps(delayed_hi, state_hi))));
+
+		// feedback and input
+		__m128 sum = _mm_add_ps(y_lo, y_hi);
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+		__m128 feedback = _mm_mul_ps(_mm_set1_ps(p_coefs->density), _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 0)));
+		__m128 input = _mm_mul_ps(sign, _mm_set1_ps(p_input[frame]));
+
+		T *write = lines + (position & line_mask) * NATIVE_REVERB_LINES;
+		native_store_frame_sse2(write, _mm_add_ps(_mm_sub_ps(y_lo, feedback), input), _mm_add_ps(_mm_sub_ps(y_hi, feedback), input));
+
+		p_network->line_position = position + 1;
+
+		// taps: (y0 - y2 + y4 - y6, y1 - y3 + y5 - y7, y0 + y3 - y4 - y7, y1 + y2 - y5 - y6)
+		__m128 t = _mm_add_ps(y_lo, y_hi);
+		__m128 u = _mm_sub_ps(t, _mm_movehl_ps(t, t));
+		__m128 d = _mm_sub_ps(y_lo, y_hi);
+		__m128 v = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 1, 2, 3)));
+		__m128 late = _mm_movelh_ps(u, v);
+
+		low_state = _mm_add_ps(_mm_add_ps(low_state, _mm_mul_ps(low_lp, _mm_sub_ps(late, low_state))), denormal);
+		_mm_storeu_ps(p_output + frame * 4, _mm_mul_ps(reverb_gain, _mm_add_ps(late, _mm_mul_ps(low_gain, low_state))));
+	}
+
+	_mm_storeu_ps(p_network->line_state, state_lo);
+	_mm_storeu_ps(p_network->line_state + 4, state_hi);
+	_mm_storeu_ps(p_network->low_state, low_state);
+}
+
+static void native_network_sse2(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_sse2_t<float>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+static void native_network_int16_sse2(NativeNetwork *p_network, const NativeReverbCoefficients *p_coefs, const float *p_input, float *p_output, uint32_t p_frames)
+{
+	native_network_sse2_t<int16_t>(p_network, p_coefs, p_input, p_output, p_frames);
+}
+
+const NativeReverbKernels native_reverb_kernels_sse2 = {
+	"SSE2",
+	native_mac_sse2,
+	native_allpass_sse2,
+	native_cmac_sse2,
+	native_network_sse2,
+	nullptr,
+	native_mac_int16_sse2,
+	nullptr,
+	native_network_int16_sse2
+};
+
+#else
+
+const NativeReverbKernels native_reverb_kernels_sse2 = { "SSE2", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+
+#endif
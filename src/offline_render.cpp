@@ -0,0 +1,161 @@
+#include "offline_render.h"
+
+#include "dr_wav.h"
+
+#include <atomic>
+#include <math.h>
+#include <thread>
+
+void offline_render_wave(AudioContext *p_context, unsigned int p_channels, std::vector<float> &p_output,
+						 const AudioAutomationEvent *p_events, size_t p_count)
+{
+	size_t quantum_frames = audio_quantum_frames(p_context);
+	std::vector<float> quantum(quantum_frames * p_channels);
+
+	if (p_count > 0)
+		audio_automation_play(p_context, p_events, p_count);
+	else
+		audio_wave_play(p_context);
+
+	while (audio_wave_playing(p_context))
+	{
+		audio_render(p_context, quantum.data(), quantum_frames);
+		p_output.insert(p_output.end(), quantum.begin(), quantum.end());
+	}
+}
+
+OfflineMetrics offline_measure(const std::vector<float> &p_samples, unsigned int p_channels)
+{
+	OfflineMetrics result = {-1.0, 0.0, -INFINITY};
+
+	size_t frames = p_samples.size() / p_channels;
+	if (frames == 0)
+		return result;
+
+	// energy per frame, summed over all channels
+	std::vector<double> energy(frames, 0.0);
+	float peak = 0.0f;
+
+	for (size_t frame = 0; frame < frames; ++frame)
+	{
+		for (unsigned int ch = 0; ch < p_channels; ++ch)
+		{
+			float s = p_samples[frame * p_channels + ch];
+			energy[frame] += (double) s * s;
+			peak = fmaxf(peak, fabsf(s));
+		}
+	}
+
+	if (peak <= 0.0f)
+		return result;
+
+	result.peak = 20.0 * log10(peak);
+
+	// the onset is the first frame within 40dB of the peak
+	double onset_threshold = (double) peak * peak * 1e-4;
+	size_t onset = 0;
+	while (onset < frames && energy[onset] < onset_threshold)
+		++onset;
+
+	// early / late energy
+	size_t early_end = onset + AUDIO_MASTER_SAMPLERATE * 80 / 1000;
+	double early = 0.0;
+	double late = 0.0;
+
+	for (size_t frame = onset; frame < frames; ++frame)
+	{
+		if (frame < early_end)
+			early += energy[frame];
+		else
+			late += energy[frame];
+	}
+
+	result.early_late_ratio = (late > 0.0) ? 10.0 * log10(early / late) : INFINITY;
+
+	// Schroeder backward integration, RT60 extrapolated from the -5dB to -25dB range (T20) or from the -5dB to -15dB
+	//	range (T10) when the rendered tail does not decay far enough
+	std::vector<double> decay(frames - onset);
+	double total = 0.0;
+
+	for (size_t frame = frames; frame > onset; --frame)
+	{
+		total += energy[frame - 1];
+		decay[frame - 1 - onset] = total;
+	}
+
+	size_t t5 = 0, t15 = 0, t25 = 0;
+
+	for (size_t idx = 0; idx < decay.size(); ++idx)
+	{
+		double level = 10.0 * log10(decay[idx] / total);
+
+		if (t5 == 0 && level <= -5.0)
+			t5 = idx;
+		if (t15 == 0 && level <= -15.0)
+			t15 = idx;
+		if (t25 == 0 && level <= -25.0)
+			t25 = idx;
+	}
+
+	if (t25 > t5)
+		result.rt60 = 3.0 * (t25 - t5) / AUDIO_MASTER_SAMPLERATE;
+	else if (t15 > t5)
+		result.rt60 = 6.0 * (t15 - t5) / AUDIO_MASTER_SAMPLERATE;
+
+	return result;
+}
+
+bool offline_write_wav(const char *p_filename, unsigned int p_channels, const std::vector<float> &p_samples)
+{
+	drwav_data_format format;
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+	format.channels = p_channels;
+	format.sampleRate = AUDIO_MASTER_SAMPLERATE;
+	format.bitsPerSample = 32;
+
+	drwav *wav = drwav_open_file_write(p_filename, &format);
+	if (wav == NULL)
+	{
+		return false;
+	}
+
+	drwav_write(wav, p_samples.size(), p_samples.data());
+	drwav_close(wav);
+	return true;
+}
+
+size_t offline_worker_count(size_t p_count)
+{
+	size_t num_threads = std::thread::hardware_concurrency();
+	if (num_threads == 0)
+		num_threads = 1;
+	if (num_threads > p_count)
+		num_threads = p_count;
+
+	return num_threads;
+}
+
+void offline_parallel_for(size_t p_count, const std::function<void(size_t p_job, size_t p_worker)> &p_job)
+{
+	size_t num_threads = offline_worker_count(p_count);
+
+	// every worker keeps taking the next index until all jobs are handed out
+	std::atomic<size_t> next_job(0);
+	std::vector<std::thread> workers;
+
+	for (size_t idx = 0; idx < num_threads; ++idx)
+	{
+		workers.push_back(std::thread([&, idx]() {
+			for (size_t job = next_job++; job < p_count; job = next_job++)
+			{
+				p_job(job, idx);
+			}
+		}));
+	}
+
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+}
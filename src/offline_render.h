@@ -0,0 +1,37 @@
+#ifndef FAUDIOFILTERDEMO_OFFLINE_RENDER_H
+#define FAUDIOFILTERDEMO_OFFLINE_RENDER_H
+
+#include "audio.h"
+
+#include <functional>
+#include <vector>
+
+// helpers shared by the headless tools that drive the offline engine
+
+// plays the loaded wave on an offline context and appends the master output to p_output until the voice stopped. The output
+//	is pulled a whole engine quantum at a time, so every render starts on a quantum boundary whatever ran before. With
+//	p_events the voice plays the automation (audio_automation_play), its frames count from the start of the render.
+void offline_render_wave(AudioContext *p_context, unsigned int p_channels, std::vector<float> &p_output,
+						 const AudioAutomationEvent *p_events = nullptr, size_t p_count = 0);
+
+// acoustic metrics of a rendered response
+struct OfflineMetrics
+{
+	double rt60;				// seconds, from the Schroeder decay curve. Negative when the tail is too short to measure
+	double early_late_ratio;	// dB, energy in the first 80ms after the onset versus everything after it (C80)
+	double peak;				// dBFS
+};
+
+OfflineMetrics offline_measure(const std::vector<float> &p_samples, unsigned int p_channels);
+
+// writes interleaved float samples at AUDIO_MASTER_SAMPLERATE to a wav file
+bool offline_write_wav(const char *p_filename, unsigned int p_channels, const std::vector<float> &p_samples);
+
+// number of worker threads offline_parallel_for uses for p_count jobs: one per core, but never more than there are jobs
+size_t offline_worker_count(size_t p_count);
+
+// runs p_job for every index in [0, p_count) on a pool of worker threads. The job also receives the index of the worker
+//	running it, so per-worker state (e.g. an AudioContext) can be set up front and reused across jobs.
+void offline_parallel_for(size_t p_count, const std::function<void(size_t p_job, size_t p_worker)> &p_job);
+
+#endif // FAUDIOFILTERDEMO_OFFLINE_RENDER_H
@@ -0,0 +1,449 @@
+// golden output regression test: renders every preset against every sample with the offline engine, compares the
+//	result to stored reference renders and fails when the output drifts beyond a tolerance or a preset got slower.
+
+#include "audio.h"
+#include "native_ir_cache.h"
+#include "native_reverb.h"
+#include "offline_render.h"
+
+#include "dr_wav.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static void print_usage(const char *p_program)
+{
+	printf("Usage: %s [options]\n", p_program);
+	printf("  -d <dir>          directory with the reference renders (default regress)\n");
+	printf("  -t <tolerance>    maximum absolute difference per sample (default 0.0001)\n");
+	printf("  -m <percent>      maximum median slowdown over all cases compared to the reference timings (default 10)\n");
+	printf("  -c <percent>      maximum slowdown of a single case beyond the median slowdown (default 50)\n");
+	printf("  -n <count>        number of timed runs per case, the fastest run counts (default 3)\n");
+	printf("  -q <frames>       processing quantum of the engine (%u - %u, default %u)\n", AUDIO_MIN_QUANTUM, AUDIO_MAX_QUANTUM, AUDIO_DEFAULT_QUANTUM);
+	printf("  -s <sample>       only test the cases of one sample, e.g. snaredrum_forte or snaredrum_forte_stereo\n");
+	printf("  --update          (re)generate the reference renders and timings instead of comparing\n");
+	printf("  --native          test the built-in reverb instead of the FAudio one\n");
+	printf("  --convolution     test the convolution mode of the built-in reverb (with --native)\n");
+	printf("  --tail-aware      stop every case once its reverb tail died out instead of after 2 seconds of silence\n");
+	printf("  --kernels <k>     inner loops of the built-in reverb: scalar, sse2, avx2 or avx512 (default: widest supported)\n");
+	printf("  --delay-format <f> delay memory of the built-in reverb: float, half or int16 (default float)\n");
+	printf("  --ir-cache <file> keep the impulse responses of the convolution mode in <file> across runs\n");
+}
+
+static std::string sample_name(bool p_stereo, int p_sample)
+{
+	// resources/snaredrum_forte.wav -> snaredrum_forte
+	std::string name = (!p_stereo) ? audio_sample_filenames[p_sample] : audio_stereo_filenames[p_sample];
+	name = name.substr(name.rfind('/') + 1);
+	name.erase(name.rfind(".wav"));
+	return name;
+}
+
+static std::string case_name(bool p_stereo, int p_sample, size_t p_preset)
+{
+	// resources/snaredrum_forte.wav + preset 7 -> snaredrum_forte_07
+	std::string name = sample_name(p_stereo, p_sample);
+
+	char suffix[8];
+	snprintf(suffix, sizeof(suffix), "_%02d", (int) p_preset);
+	return name + suffix;
+}
+
+// true when any case of p_only_sample (all samples when null) has a reference render in p_directory
+static bool has_references(const std::string &p_directory, const char *p_only_sample)
+{
+	for (int source = 0; source < 2; ++source)
+	{
+		for (int sample = 0; sample <= AudioWave_SnareDrum03; ++sample)
+		{
+			if (p_only_sample != nullptr && sample_name(source == 1, sample) != p_only_sample)
+				continue;
+
+			for (size_t preset = 0; preset < audio_reverb_preset_count; ++preset)
+			{
+				std::string reference_filename = p_directory + "/" + case_name(source == 1, sample, preset) + ".wav";
+				FILE *file = fopen(reference_filename.c_str(), "rb");
+
+				if (file != NULL)
+				{
+					fclose(file);
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+static std::map<std::string, double> read_timings(const std::string &p_filename)
+{
+	std::map<std::string, double> result;
+	FILE *file = fopen(p_filename.c_str(), "r");
+
+	if (file == NULL)
+		return result;
+
+	char name[256];
+	double ns_per_sample;
+
+	while (fscanf(file, "%255s %lf", name, &ns_per_sample) == 2)
+	{
+		result[name] = ns_per_sample;
+	}
+
+	fclose(file);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	std::string directory = "regress";
+	double tolerance = 1e-4;
+	double max_slowdown = 10.0;
+	double max_case_slowdown = 50.0;
+	const char *only_sample = nullptr;
+	int runs = 3;
+	int quantum = AUDIO_DEFAULT_QUANTUM;
+	bool update = false;
+	bool tail_aware = false;
+	AudioEngine engine = AudioEngine_Offline;
+	AudioEffectMode effect_mode = AudioEffectMode_Algorithmic;
+	const char *kernels = nullptr;
+	const char *delay_format = nullptr;
+	const char *ir_cache = nullptr;
+
+	// parse the command line
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		if (strcmp(argv[idx], "-d") == 0 && idx + 1 < argc)
+			directory = argv[++idx];
+		else if (strcmp(argv[idx], "-t") == 0 && idx + 1 < argc)
+			tolerance = atof(argv[++idx]);
+		else if (strcmp(argv[idx], "-m") == 0 && idx + 1 < argc)
+			max_slowdown = atof(argv[++idx]);
+		else if (strcmp(argv[idx], "-c") == 0 && idx + 1 < argc)
+			max_case_slowdown = atof(argv[++idx]);
+		else if (strcmp(argv[idx], "-s") == 0 && idx + 1 < argc)
+			only_sample = argv[++idx];
+		else if (strcmp(argv[idx], "-n") == 0 && idx + 1 < argc)
+			runs = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-q") == 0 && idx + 1 < argc)
+			quantum = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "--update") == 0)
+			update = true;
+		else if (strcmp(argv[idx], "--native") == 0)
+			engine = AudioEngine_Native;
+		else if (strcmp(argv[idx], "--convolution") == 0)
+			effect_mode = AudioEffectMode_Convolution;
+		else if (strcmp(argv[idx], "--tail-aware") == 0)
+			tail_aware = true;
+		else if (strcmp(argv[idx], "--kernels") == 0 && idx + 1 < argc)
+			kernels = argv[++idx];
+		else if (strcmp(argv[idx], "--delay-format") == 0 && idx + 1 < argc)
+			delay_format = argv[++idx];
+		else if (strcmp(argv[idx], "--ir-cache") == 0 && idx + 1 < argc)
+			ir_cache = argv[++idx];
+		else
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (runs < 1 || quantum < (int) AUDIO_MIN_QUANTUM || quantum > (int) AUDIO_MAX_QUANTUM)
+	{
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	// the references are generated on the box that runs the test, without them there is nothing to compare yet
+	if (!update && !has_references(directory, only_sample))
+	{
+		printf("SKIPPED: no reference renders in %s, generate them with 'make test-update'\n", directory.c_str());
+		return 0;
+	}
+
+	if (kernels != nullptr && !native_reverb_select_kernels(kernels))
+	{
+		printf("Error: the %s reverb kernels are unknown or not supported by this CPU\n", kernels);
+		return -1;
+	}
+
+	if (delay_format != nullptr && !native_reverb_select_delay_format(delay_format))
+	{
+		printf("Error: unknown delay format %s\n", delay_format);
+		return -1;
+	}
+
+	if (ir_cache != nullptr && !native_ir_cache_open(ir_cache))
+	{
+		printf("Error: unable to open the impulse response cache %s\n", ir_cache);
+		return -1;
+	}
+
+	AudioContext *context = audio_create_context(engine, false, quantum);
+
+	if (context == nullptr)
+	{
+		printf("Error: unable to create the audio engine\n");
+		return -1;
+	}
+
+	if (!audio_effect_set_mode(context, effect_mode))
+	{
+		printf("Error: only the native engine has a convolution mode\n");
+		return -1;
+	}
+
+	// with a cache the presets are captured before anything is timed
+	if (effect_mode == AudioEffectMode_Convolution)
+		native_ir_cache_precompute(AUDIO_MASTER_SAMPLERATE, 2);
+
+	audio_set_tail_mode(context, tail_aware ? AudioTailMode_Decay : AudioTailMode_Fixed);
+
+	std::string timings_filename = directory + "/timings.txt";
+	std::map<std::string, double> reference_timings = read_timings(timings_filename);
+	std::map<std::string, double> timings;
+	std::vector<std::string> untimed;
+	int failures = 0;
+	size_t compared_samples = 0;
+	size_t reference_samples = 0;
+
+	// quality loss against the references, e.g. of a reduced precision delay format
+	double worst_diff = 0.0;
+	double worst_snr = INFINITY;
+	std::string worst_diff_name;
+	std::string worst_snr_name;
+
+	for (int source = 0; source < 2; ++source)
+	{
+		for (int sample = 0; sample <= AudioWave_SnareDrum03; ++sample)
+		{
+			for (size_t preset = 0; preset < audio_reverb_preset_count; ++preset)
+			{
+				std::string name = case_name(source == 1, sample, preset);
+
+				if (only_sample != nullptr && sample_name(source == 1, sample) != only_sample)
+					continue;
+				std::string reference_filename = directory + "/" + name + ".wav";
+				ReverbParameters reverb_params = audio_reverb_presets[preset];
+
+				// render, keeping the fastest of the timed runs
+				std::vector<float> output;
+				double best_seconds = 0.0;
+
+				for (int run = 0; run < runs; ++run)
+				{
+					output.clear();
+					audio_wave_load(context, (AudioSampleWave) sample, source == 1);
+					audio_effect_change(context, true, &reverb_params, AudioReverbField_All);
+
+					auto start_time = std::chrono::steady_clock::now();
+					offline_render_wave(context, 2, output);
+					double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+					if (run == 0 || seconds < best_seconds)
+						best_seconds = seconds;
+				}
+
+				if (output.empty())
+				{
+					printf("FAIL %s: nothing rendered\n", name.c_str());
+					++failures;
+					continue;
+				}
+
+				timings[name] = best_seconds * 1e9 / (output.size() / 2);
+
+				if (update)
+				{
+					if (!offline_write_wav(reference_filename.c_str(), 2, output))
+					{
+						printf("Error: unable to create %s\n", reference_filename.c_str());
+						++failures;
+					}
+					continue;
+				}
+
+				// compare the output
+				unsigned int ref_channels;
+				unsigned int ref_samplerate;
+				drwav_uint64 ref_sample_count;
+				float *reference = drwav_open_and_read_file_f32(reference_filename.c_str(), &ref_channels, &ref_samplerate, &ref_sample_count);
+
+				if (reference == NULL)
+				{
+					printf("FAIL %s: missing reference %s\n", name.c_str(), reference_filename.c_str());
+					++failures;
+					continue;
+				}
+
+				// the voice stops with the quantum its tail ends in, with another quantum than the references were rendered
+				//	with the lengths can be up to a quantum apart. Only the common part is compared then. A tail-aware render has
+				//	its own length: it counts as silent after it stopped, beyond the reference it isn't compared.
+				size_t ref_size = (size_t) ref_sample_count;
+				size_t length_slack = (quantum != (int) AUDIO_DEFAULT_QUANTUM) ? 2 * (quantum + AUDIO_DEFAULT_QUANTUM) : 0;
+				size_t length = (output.size() < ref_size) ? output.size() : ref_size;
+
+				if (tail_aware)
+					length_slack = output.size() + ref_size;
+
+				if (ref_channels != 2 || output.size() > ref_size + length_slack || ref_size > output.size() + length_slack)
+				{
+					printf("FAIL %s: length differs (%llu samples, reference %llu)\n",
+						name.c_str(), (unsigned long long) output.size(), (unsigned long long) ref_sample_count);
+					++failures;
+					drwav_free(reference);
+					continue;
+				}
+
+				double max_diff = 0.0;
+				double signal = 0.0;
+				double noise = 0.0;
+
+				for (size_t idx = 0; idx < length; ++idx)
+				{
+					double diff = (double) output[idx] - reference[idx];
+					max_diff = fmax(max_diff, fabs(diff));
+					signal += (double) reference[idx] * reference[idx];
+					noise += diff * diff;
+				}
+
+				for (size_t idx = length; tail_aware && idx < ref_size; ++idx)
+				{
+					max_diff = fmax(max_diff, fabs((double) reference[idx]));
+					signal += (double) reference[idx] * reference[idx];
+					noise += (double) reference[idx] * reference[idx];
+				}
+
+				double snr = (noise > 0.0) ? 10.0 * log10(signal / noise) : INFINITY;
+
+				if (max_diff > worst_diff || worst_diff_name.empty())
+				{
+					worst_diff = max_diff;
+					worst_diff_name = name;
+				}
+
+				if (snr < worst_snr || worst_snr_name.empty())
+				{
+					worst_snr = snr;
+					worst_snr_name = name;
+				}
+
+				compared_samples += output.size();
+				reference_samples += ref_size;
+
+				drwav_free(reference);
+
+				if (max_diff > tolerance)
+				{
+					printf("FAIL %s: output differs by up to %g (tolerance %g)\n", name.c_str(), max_diff, tolerance);
+					++failures;
+				}
+
+				// the render times are checked once all cases ran
+				if (reference_timings.find(name) == reference_timings.end())
+					untimed.push_back(name);
+			}
+		}
+	}
+
+	// compare the render times. A single case is noisy, so the gate is the median slowdown over all cases, which follows
+	//	a slower engine but not the odd run the OS got in the way of. A case only fails on its own when it fell far behind
+	//	the median, e.g. a preset that hit a slow path.
+	std::vector<double> slowdowns;
+
+	for (auto &timing : timings)
+	{
+		auto ref_timing = reference_timings.find(timing.first);
+
+		if (!update && ref_timing != reference_timings.end())
+			slowdowns.push_back(timing.second / ref_timing->second);
+	}
+
+	if (!slowdowns.empty())
+	{
+		std::vector<double> sorted = slowdowns;
+		std::sort(sorted.begin(), sorted.end());
+		double median = (sorted.size() % 2 == 1) ? sorted[sorted.size() / 2] : 0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]);
+
+		if (median > 1.0 + max_slowdown / 100.0)
+		{
+			printf("FAIL render time: the median case is %.1f%% slower than the reference (limit %g%%)\n", (median - 1.0) * 100.0, max_slowdown);
+			++failures;
+		}
+
+		for (auto &timing : timings)
+		{
+			auto ref_timing = reference_timings.find(timing.first);
+
+			if (ref_timing == reference_timings.end() || timing.second / ref_timing->second <= median * (1.0 + max_case_slowdown / 100.0))
+				continue;
+
+			printf("FAIL %s: %.2f ns/sample, %.1f%% slower than the reference %.2f ns/sample, the median case %.1f%%\n",
+				timing.first.c_str(), timing.second, (timing.second / ref_timing->second - 1.0) * 100.0, ref_timing->second, (median - 1.0) * 100.0);
+			++failures;
+		}
+	}
+
+	// a case without a reference timing would pass the gate unchecked
+	if (!update && !untimed.empty())
+	{
+		if (reference_timings.empty())
+		{
+			printf("WARNING: %s is missing, the render times of all %zu cases were NOT checked\n", timings_filename.c_str(), untimed.size());
+		}
+		else
+		{
+			for (const std::string &name : untimed)
+				printf("FAIL %s: no reference timing in %s\n", name.c_str(), timings_filename.c_str());
+
+			failures += (int) untimed.size();
+		}
+	}
+
+	audio_destroy_context(context);
+	native_ir_cache_close();
+
+	if (update)
+	{
+		FILE *file = fopen(timings_filename.c_str(), "w");
+
+		if (file == NULL)
+		{
+			printf("Error: unable to create %s\n", timings_filename.c_str());
+			return -1;
+		}
+
+		for (auto &timing : timings)
+		{
+			fprintf(file, "%s %.3f\n", timing.first.c_str(), timing.second);
+		}
+
+		fclose(file);
+		printf("updated %zu reference renders in %s\n", timings.size(), directory.c_str());
+	}
+	else
+	{
+		printf("%zu cases, %d failures\n", timings.size(), failures);
+
+		if (!worst_diff_name.empty())
+		{
+			printf("largest difference %g (%s), lowest signal to error ratio %.1f dB (%s)\n",
+				worst_diff, worst_diff_name.c_str(), worst_snr, worst_snr_name.c_str());
+		}
+
+		if (tail_aware && reference_samples > 0)
+			printf("tail-aware renders are %.1f%% of the reference length\n", 100.0 * compared_samples / reference_samples);
+	}
+
+	return (failures == 0) ? 0 : 1;
+}
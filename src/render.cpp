@@ -0,0 +1,230 @@
+// headless offline renderer: runs a sample through the offline audio engine and writes the result to a wav file
+//	as fast as the CPU allows, without opening a window or an audio device.
+
+#include "audio.h"
+#include "audio_automation.h"
+#include "native_ir_cache.h"
+#include "native_reverb.h"
+#include "offline_render.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static void print_usage(const char *p_program)
+{
+	printf("Usage: %s [options]\n", p_program);
+	printf("  -s <index>     sample to render (0 - 2, default 0)\n");
+	printf("  -p <index>     reverb preset to apply (0 - %d, default 0)\n", (int) audio_reverb_preset_count - 1);
+	printf("  -o <file>      output wav file (default render.wav)\n");
+	printf("  -q <frames>    processing quantum of the engine (%u - %u, default %u)\n", AUDIO_MIN_QUANTUM, AUDIO_MAX_QUANTUM, AUDIO_DEFAULT_QUANTUM);
+	printf("  --stereo       use the stereo version of the sample\n");
+	printf("  --5p1          render to 5.1 channels instead of stereo\n");
+	printf("  --dry          disable the reverb effect\n");
+	printf("  --tail-aware   stop once the reverb tail died out instead of after 2 seconds of silence\n");
+	printf("  --all-presets  render every preset in parallel, to <file>_<index>_<preset>.wav\n");
+	printf("  --native       use the built-in reverb instead of the FAudio one\n");
+	printf("  --convolution  convolve with the captured impulse response of the native reverb (with --native)\n");
+	printf("  --delay-format <f> delay memory of the built-in reverb: float, half or int16 (default float)\n");
+	printf("  --ir-cache <f> keep the impulse responses of the convolution mode in file <f> across runs\n");
+	printf("  --threads <n>  extra threads of the built-in reverb for 5.1 (default: cores - 1, 0 with --all-presets)\n");
+	printf("  --automation <f> replay the parameter automation recorded in file <f> (with the GUI) against the voice\n");
+}
+
+static std::string preset_filename(const char *p_output_filename, size_t p_preset)
+{
+	// render.wav -> render_07_Concert_Hall.wav
+	std::string base = p_output_filename;
+	size_t ext = base.rfind(".wav");
+	if (ext != std::string::npos && ext + 4 == base.size())
+		base.erase(ext);
+
+	std::string name = audio_reverb_preset_names[p_preset];
+	while (!name.empty() && name.back() == ' ')
+		name.pop_back();
+	for (auto &c : name)
+		if (c == ' ')
+			c = '_';
+
+	char index[8];
+	snprintf(index, sizeof(index), "_%02d_", (int) p_preset);
+
+	return base + index + name + ".wav";
+}
+
+int main(int argc, char **argv)
+{
+	int sample_index = 0;
+	int preset_index = 0;
+	int quantum = AUDIO_DEFAULT_QUANTUM;
+	int threads = -1;
+	bool stereo = false;
+	bool reverb_enabled = true;
+	bool output_5p1 = false;
+	bool all_presets = false;
+	bool tail_aware = false;
+	AudioEngine engine = AudioEngine_Offline;
+	AudioEffectMode effect_mode = AudioEffectMode_Algorithmic;
+	const char *output_filename = "render.wav";
+	const char *delay_format = nullptr;
+	const char *ir_cache = nullptr;
+	const char *automation_filename = nullptr;
+
+	// parse the command line
+	for (int idx = 1; idx < argc; ++idx)
+	{
+		if (strcmp(argv[idx], "-s") == 0 && idx + 1 < argc)
+			sample_index = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-p") == 0 && idx + 1 < argc)
+			preset_index = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "-o") == 0 && idx + 1 < argc)
+			output_filename = argv[++idx];
+		else if (strcmp(argv[idx], "-q") == 0 && idx + 1 < argc)
+			quantum = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "--stereo") == 0)
+			stereo = true;
+		else if (strcmp(argv[idx], "--5p1") == 0)
+			output_5p1 = true;
+		else if (strcmp(argv[idx], "--dry") == 0)
+			reverb_enabled = false;
+		else if (strcmp(argv[idx], "--tail-aware") == 0)
+			tail_aware = true;
+		else if (strcmp(argv[idx], "--all-presets") == 0)
+			all_presets = true;
+		else if (strcmp(argv[idx], "--native") == 0)
+			engine = AudioEngine_Native;
+		else if (strcmp(argv[idx], "--convolution") == 0)
+			effect_mode = AudioEffectMode_Convolution;
+		else if (strcmp(argv[idx], "--delay-format") == 0 && idx + 1 < argc)
+			delay_format = argv[++idx];
+		else if (strcmp(argv[idx], "--ir-cache") == 0 && idx + 1 < argc)
+			ir_cache = argv[++idx];
+		else if (strcmp(argv[idx], "--threads") == 0 && idx + 1 < argc)
+			threads = atoi(argv[++idx]);
+		else if (strcmp(argv[idx], "--automation") == 0 && idx + 1 < argc)
+			automation_filename = argv[++idx];
+		else
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (sample_index < 0 || sample_index > AudioWave_SnareDrum03 ||
+		preset_index < 0 || preset_index >= (int) audio_reverb_preset_count ||
+		quantum < (int) AUDIO_MIN_QUANTUM || quantum > (int) AUDIO_MAX_QUANTUM)
+	{
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	if (delay_format != nullptr && !native_reverb_select_delay_format(delay_format))
+	{
+		printf("Error: unknown delay format %s\n", delay_format);
+		return -1;
+	}
+
+	if (ir_cache != nullptr && !native_ir_cache_open(ir_cache))
+	{
+		printf("Error: unable to open the impulse response cache %s\n", ir_cache);
+		return -1;
+	}
+
+	AudioAutomation automation;
+
+	if (automation_filename != nullptr && !automation.load(automation_filename))
+	{
+		printf("Error: unable to load the automation %s\n", automation_filename);
+		return -1;
+	}
+
+	if (automation.count() > 0 && effect_mode == AudioEffectMode_Convolution)
+	{
+		printf("Error: the convolution mode can't replay an automation\n");
+		return -1;
+	}
+
+	// setup one offline engine per preset to render. The contexts are created up front on this thread because creating
+	//	a context (re)assigns the audio_* entry points, the workers only call through them.
+	size_t first_preset = all_presets ? 0 : preset_index;
+	size_t preset_count = all_presets ? audio_reverb_preset_count : 1;
+	std::vector<AudioContext *> contexts(preset_count, nullptr);
+
+	// the presets already keep every core busy, the engines don't need threads of their own then
+	unsigned int workers = (threads >= 0) ? (unsigned int) threads : (all_presets ? 0 : AUDIO_AUTO_WORKERS);
+
+	for (size_t idx = 0; idx < preset_count; ++idx)
+	{
+		contexts[idx] = audio_create_context(engine, output_5p1, quantum, workers);
+
+		if (contexts[idx] == nullptr)
+		{
+			printf("Error: unable to create the audio engine\n");
+			return -1;
+		}
+
+		if (!audio_effect_set_mode(contexts[idx], effect_mode))
+		{
+			printf("Error: only the native engine has a convolution mode\n");
+			return -1;
+		}
+
+		audio_set_tail_mode(contexts[idx], tail_aware ? AudioTailMode_Decay : AudioTailMode_Fixed);
+	}
+
+	// the cache isn't thread safe: every preset is captured into it here, the workers only ever read from it then
+	if (effect_mode == AudioEffectMode_Convolution)
+		native_ir_cache_precompute(AUDIO_MASTER_SAMPLERATE, output_5p1 ? 6 : 2);
+
+	// render the sample followed by the reverb tail, until the voice stops
+	unsigned int output_channels = output_5p1 ? 6 : 2;
+	std::vector<std::vector<float>> outputs(preset_count);
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	offline_parallel_for(preset_count, [&](size_t p_idx, size_t) {
+		ReverbParameters reverb_params = audio_reverb_presets[first_preset + p_idx];
+
+		audio_wave_load(contexts[p_idx], (AudioSampleWave) sample_index, stereo);
+		audio_effect_change(contexts[p_idx], reverb_enabled, &reverb_params, AudioReverbField_All);
+		offline_render_wave(contexts[p_idx], output_channels, outputs[p_idx], automation.events(), automation.count());
+	});
+
+	auto end_time = std::chrono::steady_clock::now();
+
+	for (size_t idx = 0; idx < preset_count; ++idx)
+	{
+		audio_destroy_context(contexts[idx]);
+	}
+
+	native_ir_cache_close();
+
+	// write the results
+	double audio_seconds = 0.0;
+	const char *input_filename = (!stereo) ? audio_sample_filenames[sample_index] : audio_stereo_filenames[sample_index];
+
+	for (size_t idx = 0; idx < preset_count; ++idx)
+	{
+		std::string filename = all_presets ? preset_filename(output_filename, first_preset + idx) : output_filename;
+
+		if (!offline_write_wav(filename.c_str(), output_channels, outputs[idx]))
+		{
+			printf("Error: unable to create %s\n", filename.c_str());
+			return -1;
+		}
+
+		printf("%s + %s -> %s\n", input_filename, audio_reverb_preset_names[first_preset + idx], filename.c_str());
+		audio_seconds += (double) (outputs[idx].size() / output_channels) / AUDIO_MASTER_SAMPLERATE;
+	}
+
+	// report throughput
+	double wall_seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+	printf("rendered %.2f s of audio in %.4f s (realtime factor %.1fx)\n",
+		audio_seconds, wall_seconds, (wall_seconds > 0.0) ? audio_seconds / wall_seconds : 0.0);
+
+	return 0;
+}